@@ -0,0 +1,1077 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+#include <debug.h>
+
+#include "bench.h"
+#include "value.h"
+#include "list.h"
+#include "exec.h"
+#include "closure.h"
+#include "sched.h"
+#include "gc.h"
+#include "str.h"
+#include "optimize.h"
+#include "palette.h"
+#include "shape.h"
+#include "label.h"
+#include "drop.h"
+#include "blockrender.h"
+
+#define BENCH_ITEMS 500
+
+/* Timer 1 counts up at 32768 Hz from startup, see main */
+static uint24_t timerStart;
+
+static void startTimer(void) {
+	timerStart = timer_1_Counter;
+}
+
+static uint24_t stopTimer(void) {
+	return timer_1_Counter - timerStart;
+}
+
+static void report(const char *name, uint24_t ticks, uint24_t ops) {
+	dbg_sprintf(dbgout, "%s: %u ticks for %u ops\n", name, ticks, ops);
+}
+
+static void benchLists(void) {
+	list_t *arrayed = listNew();
+	list_t *linked[BENCH_ITEMS + 1];
+	list_t *tail;
+	uint24_t built, i;
+	float sum = 0;
+
+	linked[0] = listNew();
+	if(!arrayed || !linked[0]) return;
+
+	/* add on an arrayed list */
+	startTimer();
+	for(i = 0; i < BENCH_ITEMS; i++) {
+		listAdd(arrayed, numberValue(i));
+	}
+	report("list add", stopTimer(), BENCH_ITEMS);
+
+	/* item i of on an arrayed list */
+	startTimer();
+	for(i = 0; i < BENCH_ITEMS; i++) {
+		sum += listItem(arrayed, i).as.number;
+	}
+	report("list item (arrayed)", stopTimer(), BENCH_ITEMS);
+
+	/* in front of, building a linked list */
+	startTimer();
+	for(built = 0; built < BENCH_ITEMS; built++) {
+		linked[built + 1] = listInFront(numberValue(built), linked[built]);
+		if(!linked[built + 1]) break;
+	}
+	report("list in front of", stopTimer(), built);
+	tail = linked[built];
+
+	/* all but first of, walking down the linked list cons/cdr style */
+	startTimer();
+	for(i = 0; i < built && tail; i++) {
+		list_t *next = listAllButFirst(tail);
+		sum += listItem(tail, 0).as.number;
+		tail = next;
+	}
+	report("list all but first of", stopTimer(), i);
+
+	/* item i of on a linked list, which flattens it on the first deep access */
+	startTimer();
+	for(i = 0; i < built; i++) {
+		sum += listItem(linked[built], i).as.number;
+	}
+	report("list item (linked)", stopTimer(), built);
+
+	dbg_sprintf(dbgout, "checksum: %f\n", sum);
+}
+
+static float two = 2;
+static float half = BENCH_ITEMS / 2;
+static variable_t benchX = {"x"};
+static variable_t benchY = {"y"};
+static variable_t benchNumbers = {"numbers"};
+
+/* map ((x) * 2) over numbers */
+static scriptElem_t mapScript[] = {
+	{REPORTER_START, PRIM(MAP)},
+	{TITLE_TEXT, "map"},
+	{REPORTER_RING_START, NULL},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchX},
+	{BLOCK_END, (void*)&mapScript[3]},
+	{REPORTER_START, PRIM(MULTIPLY)},
+	{VARIABLE, (void*)&benchX},
+	{FLOAT_LITERAL, (void*)&two},
+	{BLOCK_END, (void*)&mapScript[6]},
+	{BLOCK_END, (void*)&mapScript[2]},
+	{TITLE_TEXT, "over"},
+	{VARIABLE, (void*)&benchNumbers},
+	{BLOCK_END, (void*)&mapScript[0]},
+	{END_SCRIPT, NULL}
+};
+
+/* keep items ((x) < half) from numbers */
+static scriptElem_t keepScript[] = {
+	{REPORTER_START, PRIM(KEEP)},
+	{TITLE_TEXT, "keep items"},
+	{PREDICATE_RING_START, NULL},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchX},
+	{BLOCK_END, (void*)&keepScript[3]},
+	{PREDICATE_START, PRIM(LESS)},
+	{VARIABLE, (void*)&benchX},
+	{FLOAT_LITERAL, (void*)&half},
+	{BLOCK_END, (void*)&keepScript[6]},
+	{BLOCK_END, (void*)&keepScript[2]},
+	{TITLE_TEXT, "from"},
+	{VARIABLE, (void*)&benchNumbers},
+	{BLOCK_END, (void*)&keepScript[0]},
+	{END_SCRIPT, NULL}
+};
+
+/* combine numbers using ((x) + (y)) */
+static scriptElem_t combineScript[] = {
+	{REPORTER_START, PRIM(COMBINE)},
+	{TITLE_TEXT, "combine"},
+	{VARIABLE, (void*)&benchNumbers},
+	{TITLE_TEXT, "using"},
+	{REPORTER_RING_START, NULL},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchX},
+	{UPVAR, (void*)&benchY},
+	{BLOCK_END, (void*)&combineScript[5]},
+	{REPORTER_START, PRIM(ADD)},
+	{VARIABLE, (void*)&benchX},
+	{VARIABLE, (void*)&benchY},
+	{BLOCK_END, (void*)&combineScript[9]},
+	{BLOCK_END, (void*)&combineScript[4]},
+	{BLOCK_END, (void*)&combineScript[0]},
+	{END_SCRIPT, NULL}
+};
+
+static void benchRing(thread_t *thread, const char *name, scriptElem_t *script) {
+	uint24_t mark = regionMark(&thread->region);
+	thread->region.highWater = 0;
+	startTimer();
+	execEval(thread, script);
+	report(name, stopTimer(), BENCH_ITEMS);
+
+	/* The region use should not depend on the length of the list */
+	dbg_sprintf(dbgout, "region high water: %u bytes\n", thread->region.highWater);
+
+	regionRelease(&thread->region, mark);
+}
+
+static void benchClosures(void) {
+	thread_t *thread = threadNew(mapScript, NULL);
+	list_t *numbers = listNew();
+	uint24_t i;
+
+	if(!thread || !numbers) goto freeThread;
+
+	for(i = 1; i <= BENCH_ITEMS; i++) {
+		listAdd(numbers, numberValue(i));
+	}
+	benchNumbers.value = listValue(numbers);
+
+	benchRing(thread, "map", mapScript);
+	benchRing(thread, "keep", keepScript);
+	benchRing(thread, "combine", combineScript);
+
+	benchNumbers.value = noneValue();
+
+	freeThread:
+	if(thread) threadFree(thread);
+}
+
+static float one = 1;
+static float twenty = 20;
+static float repeats = BENCH_ITEMS;
+
+/* when flag clicked, repeat [set x to (numbers from 1 to 20)] */
+static scriptElem_t garbageScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, PRIM(NUMBERS)},
+	{TITLE_TEXT, "numbers from"},
+	{FLOAT_LITERAL, (void*)&one},
+	{TITLE_TEXT, "to"},
+	{FLOAT_LITERAL, (void*)&twenty},
+	{BLOCK_END, (void*)&garbageScript[9]},
+	{BLOCK_END, (void*)&garbageScript[5]},
+	{BLOCK_END, (void*)&garbageScript[4]},
+	{BLOCK_END, (void*)&garbageScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* Run a script that makes lots of garbage, collecting it between steps */
+static void benchGarbage(void) {
+	uint24_t steps = 0;
+	uint24_t length = 0;
+
+	if(!schedStart(garbageScript, NULL)) return;
+
+	startTimer();
+	while(schedStep()) steps++;
+	report("garbage script", stopTimer(), steps);
+
+	/* The last list is only reachable from the global it was set to */
+	gcCollect();
+	if(benchX.value.type == VAL_LIST) length = listLength(benchX.value.as.list);
+	dbg_sprintf(dbgout, "x has %u items after collecting, should be 20\n", length);
+
+	gcPrintStats();
+}
+
+/* when flag clicked, repeat [set x to (join x "ab")] */
+static scriptElem_t joinScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, PRIM(JOIN)},
+	{TITLE_TEXT, "join"},
+	{ARGLIST_START, NULL},
+	{VARIABLE, (void*)&benchX},
+	{STRING_LITERAL, "ab"},
+	{BLOCK_END, (void*)&joinScript[11]},
+	{BLOCK_END, (void*)&joinScript[9]},
+	{BLOCK_END, (void*)&joinScript[5]},
+	{BLOCK_END, (void*)&joinScript[4]},
+	{BLOCK_END, (void*)&joinScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* Build up a long text one join at a time, which would be quadratic if every join copied */
+static void benchJoin(void) {
+	char buf[STR_NUMBER_SIZE];
+	uint24_t steps = 0;
+
+	benchX.value = textValue("");
+	if(!schedStart(joinScript, NULL)) return;
+
+	startTimer();
+	while(schedStep()) steps++;
+	report("join script", stopTimer(), steps);
+
+	/* Reading the text flattens the rope */
+	startTimer();
+	valueToText(benchX.value, buf);
+	report("flatten", stopTimer(), valueTextLength(benchX.value));
+
+	gcPrintStats();
+}
+
+static float three = 3;
+static float four = 4;
+
+/* when flag clicked, repeat [set x to (((2) * (3)) + ((4) / (2)))] */
+static scriptElem_t constScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, PRIM(ADD)},
+	{REPORTER_START, PRIM(MULTIPLY)},
+	{FLOAT_LITERAL, (void*)&two},
+	{FLOAT_LITERAL, (void*)&three},
+	{BLOCK_END, (void*)&constScript[10]},
+	{REPORTER_START, PRIM(DIVIDE)},
+	{FLOAT_LITERAL, (void*)&four},
+	{FLOAT_LITERAL, (void*)&two},
+	{BLOCK_END, (void*)&constScript[14]},
+	{BLOCK_END, (void*)&constScript[9]},
+	{BLOCK_END, (void*)&constScript[5]},
+	{BLOCK_END, (void*)&constScript[4]},
+	{BLOCK_END, (void*)&constScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+static void benchScript(const char *name, scriptElem_t *script) {
+	uint24_t steps = 0;
+
+	if(!schedStart(script, NULL)) return;
+
+	startTimer();
+	while(schedStep()) steps++;
+	report(name, stopTimer(), steps);
+}
+
+/* Run the same arithmetic with and without constant folding */
+static void benchFolding(void) {
+	optScript_t *opt;
+
+	benchScript("unfolded script", constScript);
+
+	startTimer();
+	opt = optimizeScript(constScript);
+	report("optimize", stopTimer(), sizeof(constScript) / sizeof(scriptElem_t));
+	if(!opt) return;
+
+	benchScript("folded script", opt->elems);
+	dbg_sprintf(dbgout, "x = %f\n", valueToNumber(benchX.value));
+
+	optimizeFree(opt);
+}
+
+static float five = 5;
+static variable_t benchResult = {"result"};
+
+/* capture (x): set y to (ring (x)), set x to 5, report (map (y) over (numbers from 1 to 1)) */
+static scriptElem_t captureDef[] = {
+	{CUSTOM_BLOCK_START, (void*)OPERATORS},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchX},
+	{BLOCK_END, (void*)&captureDef[1]},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchY},
+	{TITLE_TEXT, "to"},
+	{REPORTER_RING_START, NULL},
+	{VARIABLE, (void*)&benchX},
+	{BLOCK_END, (void*)&captureDef[8]},
+	{BLOCK_END, (void*)&captureDef[4]},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "to"},
+	{FLOAT_LITERAL, (void*)&five},
+	{BLOCK_END, (void*)&captureDef[12]},
+	{BLOCK_START, PRIM(REPORT)},
+	{REPORTER_START, PRIM(MAP)},
+	{TITLE_TEXT, "map"},
+	{VARIABLE, (void*)&benchY},
+	{TITLE_TEXT, "over"},
+	{REPORTER_START, PRIM(NUMBERS)},
+	{TITLE_TEXT, "numbers from"},
+	{FLOAT_LITERAL, (void*)&one},
+	{TITLE_TEXT, "to"},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&captureDef[23]},
+	{BLOCK_END, (void*)&captureDef[19]},
+	{BLOCK_END, (void*)&captureDef[18]},
+	{BLOCK_END, (void*)&captureDef[0]}
+};
+
+/* when flag clicked, set result to (capture 1) */
+static scriptElem_t captureScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchResult},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, (void*)captureDef},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&captureScript[5]},
+	{BLOCK_END, (void*)&captureScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* A ring sees its variables being set after it was made, even once it has been stored in a variable */
+static void benchCapture(void) {
+	value_t captured = noneValue();
+
+	benchScript("capture", captureScript);
+	gcCollect();
+
+	if(benchResult.value.type == VAL_LIST && listLength(benchResult.value.as.list)) {
+		captured = listItem(benchResult.value.as.list, 0);
+	}
+	dbg_sprintf(dbgout, "captured x = %f, should be 5\n", valueToNumber(captured));
+
+	benchResult.value = noneValue();
+	benchY.value = noneValue();
+}
+
+/* ring (x) */
+static scriptElem_t captureRing[] = {
+	{REPORTER_RING_START, NULL},
+	{VARIABLE, (void*)&benchX},
+	{BLOCK_END, (void*)&captureRing[0]},
+	{END_SCRIPT, NULL}
+};
+
+/* Capture a local that was set to something the collector hasn't seen yet, partway through marking */
+/* The list has to survive the rest of the cycle, even though the box holding it starts out black */
+static void benchCaptureMidMark(void) {
+	thread_t *thread = threadNew(captureRing, NULL);
+	uint24_t budget = gcBudget;
+	uint24_t length = 0;
+	closure_t *closure;
+	list_t *list;
+	env_t *env;
+
+	if(!thread) return;
+
+	env = regionAlloc(&thread->region, sizeof(env_t) + sizeof(binding_t));
+	if(!env) goto freeThread;
+	env->slots = (binding_t*)(env + 1);
+	env->count = 1;
+	env->slots[0].var = &benchX;
+	env->slots[0].value = noneValue();
+	env->slots[0].box = NULL;
+	thread->env = env;
+
+	/* Made between cycles, and not reachable from any root when marking starts */
+	gcCollect();
+	list = listNew();
+	if(!list) goto freeThread;
+	listAdd(list, numberValue(1));
+	listAdd(list, numberValue(2));
+	listAdd(list, numberValue(3));
+
+	gcStartCycle();
+	gcBudget = 0;
+	gcSlice();
+	gcBudget = budget;
+
+	/* Locals are set without a write barrier, since environments are roots */
+	env->slots[0].value = listValue(list);
+	closure = closureNew(thread, captureRing);
+	if(!closure) goto freeThread;
+	benchY.value = execKeep(thread, closureValue(closure));
+	gcAddVariable(&benchY);
+
+	gcCollect();
+
+	closure = benchY.value.as.closure;
+	if(benchY.value.type == VAL_CLOSURE && closure->numSlots && closure->slots[0].box) {
+		value_t captured = closure->slots[0].box->value;
+		if(captured.type == VAL_LIST) length = listLength(captured.as.list);
+	}
+	dbg_sprintf(dbgout, "list captured while marking has %u items, should be 3\n", length);
+
+	benchY.value = noneValue();
+
+	freeThread:
+	threadFree(thread);
+}
+
+static float zero = 0;
+static float eight = 8;
+static float fifty = 50;
+static float thousand = 1000;
+static variable_t benchN = {"n"};
+static variable_t benchAcc = {"acc"};
+
+/* countdown (n): if (n) > 0 [countdown ((n) - 1)] */
+static scriptElem_t countdownDef[] = {
+	{CUSTOM_BLOCK_START, (void*)CONTROL},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchN},
+	{BLOCK_END, (void*)&countdownDef[1]},
+	{BLOCK_START, PRIM(IF)},
+	{PREDICATE_START, PRIM(GREATER)},
+	{VARIABLE, (void*)&benchN},
+	{FLOAT_LITERAL, (void*)&zero},
+	{BLOCK_END, (void*)&countdownDef[5]},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, (void*)countdownDef},
+	{REPORTER_START, PRIM(SUBTRACT)},
+	{VARIABLE, (void*)&benchN},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&countdownDef[11]},
+	{BLOCK_END, (void*)&countdownDef[10]},
+	{BLOCK_END, (void*)&countdownDef[9]},
+	{BLOCK_END, (void*)&countdownDef[4]},
+	{BLOCK_END, (void*)&countdownDef[0]}
+};
+
+/* sum (n) (acc): if (n) = 0 [report acc] else [report (sum ((n) - 1) ((acc) + (n)))] */
+static scriptElem_t sumDef[] = {
+	{CUSTOM_BLOCK_START, (void*)OPERATORS},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchN},
+	{UPVAR, (void*)&benchAcc},
+	{BLOCK_END, (void*)&sumDef[1]},
+	{BLOCK_START, PRIM(IF_ELSE)},
+	{PREDICATE_START, PRIM(EQUALS)},
+	{VARIABLE, (void*)&benchN},
+	{FLOAT_LITERAL, (void*)&zero},
+	{BLOCK_END, (void*)&sumDef[6]},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(REPORT)},
+	{VARIABLE, (void*)&benchAcc},
+	{BLOCK_END, (void*)&sumDef[11]},
+	{BLOCK_END, (void*)&sumDef[10]},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(REPORT)},
+	{REPORTER_START, (void*)sumDef},
+	{REPORTER_START, PRIM(SUBTRACT)},
+	{VARIABLE, (void*)&benchN},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&sumDef[18]},
+	{REPORTER_START, PRIM(ADD)},
+	{VARIABLE, (void*)&benchAcc},
+	{VARIABLE, (void*)&benchN},
+	{BLOCK_END, (void*)&sumDef[22]},
+	{BLOCK_END, (void*)&sumDef[17]},
+	{BLOCK_END, (void*)&sumDef[16]},
+	{BLOCK_END, (void*)&sumDef[15]},
+	{BLOCK_END, (void*)&sumDef[5]},
+	{BLOCK_END, (void*)&sumDef[0]}
+};
+
+/* when flag clicked, repeat 50 [countdown 8] */
+static scriptElem_t shallowScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&fifty},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, (void*)countdownDef},
+	{FLOAT_LITERAL, (void*)&eight},
+	{BLOCK_END, (void*)&shallowScript[5]},
+	{BLOCK_END, (void*)&shallowScript[4]},
+	{BLOCK_END, (void*)&shallowScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* when flag clicked, countdown 1000 */
+static scriptElem_t deepScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, (void*)countdownDef},
+	{FLOAT_LITERAL, (void*)&thousand},
+	{BLOCK_END, (void*)&deepScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* when flag clicked, set x to (sum 500 0) */
+static scriptElem_t sumScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, (void*)sumDef},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{FLOAT_LITERAL, (void*)&zero},
+	{BLOCK_END, (void*)&sumScript[5]},
+	{BLOCK_END, (void*)&sumScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+static void benchCalls(const char *name, scriptElem_t *script) {
+	execStats.tailCalls = 0;
+	execStats.maxDepth = 0;
+	benchScript(name, script);
+	dbg_sprintf(dbgout, "max depth %u, %u tail calls\n", execStats.maxDepth, execStats.tailCalls);
+}
+
+/* Recursion in tail position should run in constant depth */
+static void benchRecursion(void) {
+	execTailCalls = false;
+	benchCalls("recursion without tail calls", shallowScript);
+	execTailCalls = true;
+	benchCalls("recursion with tail calls", shallowScript);
+
+	/* Too deep to run at all without tail calls */
+	benchCalls("deep recursion", deepScript);
+	benchCalls("tail recursive reporter", sumScript);
+	dbg_sprintf(dbgout, "x = %f\n", valueToNumber(benchX.value));
+}
+
+/* square (n): report (n) * (n) */
+static scriptElem_t squareDef[] = {
+	{CUSTOM_BLOCK_START, (void*)OPERATORS},
+	{ARGLIST_START, NULL},
+	{UPVAR, (void*)&benchN},
+	{BLOCK_END, (void*)&squareDef[1]},
+	{BLOCK_START, PRIM(REPORT)},
+	{REPORTER_START, PRIM(MULTIPLY)},
+	{VARIABLE, (void*)&benchN},
+	{VARIABLE, (void*)&benchN},
+	{BLOCK_END, (void*)&squareDef[5]},
+	{BLOCK_END, (void*)&squareDef[4]},
+	{BLOCK_END, (void*)&squareDef[0]}
+};
+
+/* when flag clicked, repeat [set y to (square x)] */
+static scriptElem_t squareScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(SET_VAR)},
+	{TITLE_TEXT, "set"},
+	{VARIABLE, (void*)&benchY},
+	{TITLE_TEXT, "to"},
+	{REPORTER_START, (void*)squareDef},
+	{VARIABLE, (void*)&benchX},
+	{BLOCK_END, (void*)&squareScript[9]},
+	{BLOCK_END, (void*)&squareScript[5]},
+	{BLOCK_END, (void*)&squareScript[4]},
+	{BLOCK_END, (void*)&squareScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* Call a small custom reporter with and without inlining */
+static void benchInlining(void) {
+	optScript_t *opt;
+
+	benchX.value = numberValue(3);
+	benchCalls("custom reporter calls", squareScript);
+
+	opt = optimizeScript(squareScript);
+	if(!opt) return;
+
+	benchCalls("inlined custom reporter", opt->elems);
+	dbg_sprintf(dbgout, "y = %f\n", valueToNumber(benchY.value));
+
+	optimizeFree(opt);
+}
+
+/* when flag clicked, repeat [change x by 1] */
+static scriptElem_t countScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(CHANGE_VAR)},
+	{TITLE_TEXT, "change"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "by"},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&countScript[5]},
+	{BLOCK_END, (void*)&countScript[4]},
+	{BLOCK_END, (void*)&countScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* when flag clicked, warp [repeat [change x by 1]] */
+static scriptElem_t warpScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(WARP)},
+	{TITLE_TEXT, "warp"},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(REPEAT)},
+	{TITLE_TEXT, "repeat"},
+	{FLOAT_LITERAL, (void*)&repeats},
+	{C_BLOCK_START, NULL},
+	{BLOCK_START, PRIM(CHANGE_VAR)},
+	{TITLE_TEXT, "change"},
+	{VARIABLE, (void*)&benchX},
+	{TITLE_TEXT, "by"},
+	{FLOAT_LITERAL, (void*)&one},
+	{BLOCK_END, (void*)&warpScript[8]},
+	{BLOCK_END, (void*)&warpScript[7]},
+	{BLOCK_END, (void*)&warpScript[4]},
+	{BLOCK_END, (void*)&warpScript[3]},
+	{BLOCK_END, (void*)&warpScript[1]},
+	{END_SCRIPT, NULL}
+};
+
+/* Run a script with the screen being cleared after every step, like a frame of the stage being redrawn */
+static void benchFrames(const char *name, scriptElem_t *script) {
+	uint24_t frames = 0;
+
+	benchX.value = numberValue(0);
+	execStats.warpIterations = 0;
+	execStats.warpYields = 0;
+	if(!schedStart(script, NULL)) return;
+
+	startTimer();
+	while(schedStep()) {
+		gfx_FillScreen(gfx_black);
+		frames++;
+	}
+	report(name, stopTimer(), frames);
+	dbg_sprintf(dbgout, "%u iterations without yielding, %u yields out of time\n",
+		execStats.warpIterations, execStats.warpYields);
+}
+
+/* Without warp, every loop iteration waits for a frame */
+static void benchWarp(void) {
+	benchFrames("loop with a frame per iteration", countScript);
+	benchFrames("warped loop", warpScript);
+	dbg_sprintf(dbgout, "x = %f\n", valueToNumber(benchX.value));
+}
+
+/* The shapes as they were drawn before the span cache, to check that nothing changed */
+
+static void refPredicate(int24_t x, int24_t y, uint24_t width, uint24_t height, uint24_t capWidth) {
+	uint24_t halfHeight = height / 2;
+	uint24_t doubleCapWidth = capWidth * 2;
+	int24_t xl = x;
+	int24_t xr = x + width;
+	uint24_t i;
+
+	for(i = 0; i < capWidth; i++) {
+		uint24_t halfSliceHeight = ((i * 2 + 1) * halfHeight + capWidth) / doubleCapWidth;
+		uint24_t sliceHeight = halfSliceHeight * 2 + (height & 1);
+		int24_t sliceY = y - halfSliceHeight;
+		gfx_VertLine(xl++, sliceY, sliceHeight);
+		gfx_VertLine(--xr, sliceY, sliceHeight);
+	}
+
+	gfx_FillRectangle(xl, y - halfHeight, xr - xl, height);
+}
+
+static void refReporter(int24_t x, int24_t y, uint24_t width, uint24_t height) {
+	uint24_t i;
+
+	for(i = 0; i < 3; i++) {
+		gfx_HorizLine(x + 3 - i, y + i, width - 6 + 2 * i);
+		gfx_HorizLine(x + 3 - i, y + height - i - 1, width - 6 + 2 * i);
+	}
+
+	gfx_FillRectangle(x, y + 3, width, height - 6);
+}
+
+static void refBlock(int24_t x, int24_t y, uint24_t width, uint24_t height, const blockPalette_t *pal) {
+	gfx_UninitedSprite(tmpSprite, NOTCH_SIZE, NOTCH_DEPTH);
+	int i;
+
+	tmpSprite->width  = NOTCH_SIZE;
+	tmpSprite->height = NOTCH_DEPTH;
+	gfx_GetSprite(tmpSprite, x + NOTCH_OFFSET, y);
+
+	gfx_SetColor(pal->light);
+	gfx_HorizLine(x + 1, y, width - 2);
+	gfx_VertLine(x, y + 1, height - 2);
+
+	gfx_SetColor(pal->dark);
+	gfx_HorizLine(x + 1, y + height - 1, NOTCH_OFFSET - 1);
+	gfx_HorizLine(x + NOTCH_OFFSET + NOTCH_SIZE, y + height - 1, width - 1 - (NOTCH_OFFSET + NOTCH_SIZE));
+	gfx_VertLine(x + width - 1, y + 1, height - 2);
+
+	gfx_SetColor(pal->base);
+	gfx_FillRectangle(x + 1, y + 1, width - 2, height - 2);
+	gfx_HorizLine(x + NOTCH_OFFSET, y + height - 1, NOTCH_SIZE);
+
+	gfx_Sprite(tmpSprite, x + NOTCH_OFFSET, y);
+
+	for(i = 0; i < NOTCH_DEPTH; i++) {
+		gfx_SetColor(pal->base);
+		gfx_HorizLine(x + NOTCH_OFFSET + 1, y + i, i - 1);
+		gfx_HorizLine(x + NOTCH_OFFSET + NOTCH_SIZE - i, y + i, i);
+
+		if(i == NOTCH_DEPTH - 1) gfx_SetColor(pal->dark);
+		gfx_HorizLine(x + NOTCH_OFFSET + i, y + height + i, NOTCH_SIZE - 2 * i - 1);
+
+		gfx_SetColor(pal->light);
+		gfx_SetPixel(x + NOTCH_OFFSET + i - 1, y + i);
+
+		gfx_SetColor(pal->dark);
+		gfx_SetPixel(x + NOTCH_OFFSET + NOTCH_SIZE - 1 - i, y + height + i);
+	}
+}
+
+#define SHAPE_X 20
+#define SHAPE_Y 20
+#define SHAPE_BOX_WIDTH 160
+#define SHAPE_BOX_HEIGHT 40
+#define SHAPE_BG 0x4A
+#define SHAPE_REPEATS 100
+
+/* Draw a shape the old way or the new way, with its top left corner at SHAPE_X, SHAPE_Y */
+static void drawTestShape(uint8_t kind, uint24_t width, uint24_t height, bool spans) {
+	const blockPalette_t *pal = &palette[MOTION];
+	uint8_t cap = kind == SHAPE_PREDICATE ? 5 : 0;
+
+	if(spans) {
+		shape_t *shape = getShape(kind, width, height, cap);
+		if(shape) drawShape(shape, SHAPE_X, SHAPE_Y, width, pal);
+		return;
+	}
+
+	gfx_SetColor(pal->base);
+	switch(kind) {
+		case SHAPE_PREDICATE:
+			refPredicate(SHAPE_X, SHAPE_Y + height / 2, width, height, cap);
+			break;
+		case SHAPE_REPORTER:
+			refReporter(SHAPE_X, SHAPE_Y, width, height);
+			break;
+		case SHAPE_BLOCK:
+			refBlock(SHAPE_X, SHAPE_Y, width, height, pal);
+			break;
+	}
+}
+
+/* Copy the area around the test shape out of the buffer */
+static void saveTestBox(uint8_t *box) {
+	uint24_t row;
+
+	for(row = 0; row < SHAPE_BOX_HEIGHT; row++) {
+		memcpy(&box[row * SHAPE_BOX_WIDTH], &gfx_vbuffer[SHAPE_Y - 1 + row][SHAPE_X - 1], SHAPE_BOX_WIDTH);
+	}
+}
+
+/* Check that spans draw exactly the same pixels as the old code, then time both */
+static void benchShapes(void) {
+	static const char *names[NUM_SHAPE_KINDS] = {"predicate", "reporter", "block"};
+	static const uint8_t heights[] = {8, 13, 18, 25};
+	static const uint8_t widths[] = {20, 40, 73, 150};
+	uint8_t *expected = malloc(SHAPE_BOX_WIDTH * SHAPE_BOX_HEIGHT);
+	uint8_t *actual = malloc(SHAPE_BOX_WIDTH * SHAPE_BOX_HEIGHT);
+	uint8_t kind, h, w;
+	uint24_t i, mismatches = 0;
+
+	if(!expected || !actual) goto done;
+
+	for(kind = 0; kind < NUM_SHAPE_KINDS; kind++) {
+		for(h = 0; h < sizeof(heights); h++) {
+			for(w = 0; w < sizeof(widths); w++) {
+				gfx_FillScreen(SHAPE_BG);
+				drawTestShape(kind, widths[w], heights[h], false);
+				saveTestBox(expected);
+
+				gfx_FillScreen(SHAPE_BG);
+				drawTestShape(kind, widths[w], heights[h], true);
+				saveTestBox(actual);
+
+				if(memcmp(expected, actual, SHAPE_BOX_WIDTH * SHAPE_BOX_HEIGHT)) {
+					dbg_sprintf(dbgerr, "%s %ux%u doesn't match\n", names[kind], widths[w], heights[h]);
+					mismatches++;
+				}
+			}
+		}
+
+		startTimer();
+		for(i = 0; i < SHAPE_REPEATS; i++) drawTestShape(kind, 73, 18, false);
+		report(names[kind], stopTimer(), SHAPE_REPEATS);
+
+		startTimer();
+		for(i = 0; i < SHAPE_REPEATS; i++) drawTestShape(kind, 73, 18, true);
+		report("  with spans", stopTimer(), SHAPE_REPEATS);
+	}
+
+	dbg_sprintf(dbgout, "%u shapes differ\n", mismatches);
+	gfx_FillScreen(SHAPE_BG);
+
+	done:
+	free(expected);
+	free(actual);
+}
+
+/* Labels */
+
+#define LABEL_REPEATS 100
+
+static const char labelText[] = "numbers from 1 to 10";
+
+/* Draw a label the old way, with graphx clipping only when it crosses the edge */
+static void refLabel(int24_t x, int24_t y) {
+	if(x < 0 || x + (int24_t)gfx_GetStringWidth(labelText) > LCD_WIDTH) {
+		gfx_SetTextConfig(gfx_text_clip);
+	}
+	gfx_SetTextFGColor(gfx_white);
+	gfx_PrintStringXY(labelText, x, y);
+	gfx_SetTextConfig(gfx_text_noclip);
+}
+
+static void benchLabels(void) {
+	static const char *names[] = {"label onscreen", "label on left edge", "label on right edge"};
+	static const int24_t xs[] = {40, -50, LCD_WIDTH - 50};
+	uint8_t i;
+	uint24_t j;
+
+	gfx_SetTextScale(1, 1);
+
+	for(i = 0; i < sizeof(xs) / sizeof(xs[0]); i++) {
+		startTimer();
+		for(j = 0; j < LABEL_REPEATS; j++) refLabel(xs[i], 100);
+		report(names[i], stopTimer(), LABEL_REPEATS);
+
+		startTimer();
+		for(j = 0; j < LABEL_REPEATS; j++) drawText(labelText, xs[i], 100, gfx_white);
+		report("  with glyph runs", stopTimer(), LABEL_REPEATS);
+	}
+
+	gfx_FillScreen(SHAPE_BG);
+}
+
+/* when flag clicked, say (ring [say a, say b]), say <not <>> */
+static scriptElem_t dropScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{BLOCK_RING_START, NULL},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{STRING_LITERAL, "a"},
+	{BLOCK_END, (void*)&dropScript[4]},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{STRING_LITERAL, "b"},
+	{BLOCK_END, (void*)&dropScript[8]},
+	{BLOCK_END, (void*)&dropScript[3]},
+	{BLOCK_END, (void*)&dropScript[1]},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{PREDICATE_START, PRIM(NOT)},
+	{TITLE_TEXT, "not"},
+	{BOOLEAN_LITERAL, (void*)2},
+	{BLOCK_END, (void*)&dropScript[16]},
+	{BLOCK_END, (void*)&dropScript[14]},
+	{END_SCRIPT, NULL}
+};
+
+/* The same script after say b is picked up out of the ring */
+static scriptElem_t droppedScript[] = {
+	{ON_GREEN_FLAG, NULL},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{BLOCK_RING_START, NULL},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{STRING_LITERAL, "a"},
+	{BLOCK_END, (void*)&droppedScript[4]},
+	{BLOCK_END, (void*)&droppedScript[3]},
+	{BLOCK_END, (void*)&droppedScript[1]},
+	{BLOCK_START, PRIM(SAY)},
+	{TITLE_TEXT, "say"},
+	{PREDICATE_START, PRIM(NOT)},
+	{TITLE_TEXT, "not"},
+	{BOOLEAN_LITERAL, (void*)2},
+	{BLOCK_END, (void*)&droppedScript[12]},
+	{BLOCK_END, (void*)&droppedScript[10]},
+	{END_SCRIPT, NULL}
+};
+
+#define DROP_X 20
+#define DROP_Y 20
+#define DROP_RANGE 20
+#define DROP_STEP 3
+
+/* Where the element passed in was laid out */
+typedef struct DropBox {
+	scriptElem_t *elem;
+	int24_t top;
+	uint24_t height;
+} dropBox_t;
+
+static void findDropBox(scriptElem_t *elem, scriptElem_t *parent, int24_t x, int24_t top, uint24_t width, uint24_t height, void *data) {
+	dropBox_t *box = data;
+
+	if(elem != box->elem) return;
+	box->top = top;
+	box->height = height;
+}
+
+/* Squared distance to the closest target that is in range, by checking every target, or -1 if there aren't any */
+static int24_t scanNearest(dropIndex_t *index, int24_t x, int24_t y, uint8_t type) {
+	int24_t nearest = -1;
+	uint24_t i;
+
+	for(i = 0; i < index->numTargets; i++) {
+		dropTarget_t *target = &index->targets[i];
+		int24_t dx = target->x - x;
+		int24_t dy = target->y - y;
+
+		if(target->removed || !dropAccepts(target->kind, type)) continue;
+		if(dx < -DROP_RANGE || dx > DROP_RANGE || dy < -DROP_RANGE || dy > DROP_RANGE) continue;
+		if(nearest < 0 || dx * dx + dy * dy < nearest) nearest = dx * dx + dy * dy;
+	}
+
+	return nearest;
+}
+
+/* Count the points around the script where dropNearest doesn't find the same distance as scanning expected */
+static uint24_t checkNearest(dropIndex_t *index, dropIndex_t *expected) {
+	static const uint8_t types[] = {BLOCK_START, PREDICATE_START};
+	uint24_t mismatches = 0;
+	int24_t x, y;
+	uint8_t i;
+
+	for(y = 0; y < DROP_Y + 150; y += DROP_STEP) {
+		for(x = 0; x < DROP_X + 150; x += DROP_STEP) {
+			for(i = 0; i < sizeof(types); i++) {
+				dropTarget_t *target = dropNearest(index, x, y, types[i], DROP_RANGE);
+				int24_t distance = target ? (target->x - x) * (target->x - x) + (target->y - y) * (target->y - y) : -1;
+				if(distance != scanNearest(expected, x, y, types[i])) mismatches++;
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+/* Check the drop index against a full scan, before and after a subtree is picked up, then time it */
+static void benchDrop(void) {
+	uint24_t length = getScriptLength(dropScript);
+	uint24_t droppedLength = getScriptLength(droppedScript);
+	uint24_t *widthCache = calloc(length, sizeof(uint24_t));
+	uint24_t *heightCache = calloc(length, sizeof(uint24_t));
+	uint24_t *droppedWidthCache = calloc(droppedLength, sizeof(uint24_t));
+	uint24_t *droppedHeightCache = calloc(droppedLength, sizeof(uint24_t));
+	dropIndex_t index, expected;
+	dropBox_t box;
+	uint24_t before, after, i;
+
+	if(!widthCache || !heightCache || !droppedWidthCache || !droppedHeightCache) goto done;
+	if(!dropInit(&index)) goto done;
+	if(!dropInit(&expected)) goto freeIndex;
+
+	dropAddScript(&index, dropScript, DROP_X, DROP_Y, widthCache, heightCache);
+	before = checkNearest(&index, &index);
+
+	box.elem = &dropScript[8];
+	layoutScript(dropScript, DROP_X, DROP_Y, widthCache, heightCache, findDropBox, &box);
+	dropRemove(&index, &dropScript[8], &dropScript[11], box.top, box.height);
+
+	dropAddScript(&expected, droppedScript, DROP_X, DROP_Y, droppedWidthCache, droppedHeightCache);
+	after = checkNearest(&index, &expected);
+
+	dbg_sprintf(dbgout, "%u drop queries differ from a full scan before picking up, %u after\n", before, after);
+
+	startTimer();
+	for(i = 0; i < BENCH_ITEMS; i++) dropNearest(&index, DROP_X + 40, DROP_Y + 40, BLOCK_START, DROP_RANGE);
+	report("nearest drop target", stopTimer(), BENCH_ITEMS);
+
+	dropFree(&expected);
+freeIndex:
+	dropFree(&index);
+done:
+	free(widthCache);
+	free(heightCache);
+	free(droppedWidthCache);
+	free(droppedHeightCache);
+}
+
+void runBenchmarks(void) {
+	benchLists();
+	benchClosures();
+	benchGarbage();
+	benchJoin();
+	benchFolding();
+	benchCapture();
+	benchCaptureMidMark();
+	benchRecursion();
+	benchInlining();
+	benchWarp();
+	benchShapes();
+	benchLabels();
+	benchDrop();
+}
@@ -0,0 +1,20 @@
+#ifndef H_BENCH
+#define H_BENCH
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Uncomment this to run the microbenchmarks at startup */
+/* Results are printed to the debug console, in 32768 Hz timer ticks */
+/* #define BENCHMARK */
+
+void runBenchmarks(void);
+
+#endif
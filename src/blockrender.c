@@ -14,6 +14,9 @@
 
 #include "script.h"
 #include "blockrender.h"
+#include "palette.h"
+#include "shape.h"
+#include "label.h"
 
 #include "gfx/gfx_group.h"
 
@@ -22,42 +25,50 @@
 #define RIGHT_MARGIN	  3 // Distance between the last argument in a block and the right edge
 #define ARG_SPACING		  4 // Space between two arguments of a block
 #define PRED_CAP_WIDTH	  5 // The width of the triangular part at both ends of a predicate
-#define NOTCH_DEPTH		  3 // Height of the notch on a block
-#define NOTCH_OFFSET	 10 // Pixels from the left of a block before the notch starts
-#define NOTCH_SIZE		(10 + 2 * NOTCH_DEPTH) // Width of the notch, including the sloped sides
 #define HAT_HEIGHT		  9 // Height of the curved section of a hat block
 #define HAT_MIN_WIDTH	 69 // Width of the curved section of a hat block
 
-#define COLOR_TRUE 0x45  // Color used to represent true  in Boolean literals
-#define COLOR_FALSE 0xC9 // Color used to represent false in Boolean literals
-#define COLOR_BOOL_SELECT 0xDE // Color of the circle in the Boolean literal's toggle
+/* Columns covered by each row of the curved section of a hat block, from its left edge */
+static const struct {
+	uint8_t start;
+	uint8_t end;
+} hatRows[HAT_HEIGHT] = {
+	{13, 36}, {10, 39}, {8, 43}, {5, 46}, {4, 49}, {2, 53}, {0, 57}, {0, 68}, {0, HAT_MIN_WIDTH}
+};
+
+/* Draw the curved section of a hat block, in the block's colors */
+/* The parts of each row that stick out past the row above are the edge */
+static void drawHat(int24_t x, int24_t y, const blockPalette_t *pal) {
+	uint8_t start = HAT_MIN_WIDTH;
+	uint8_t end = 0;
+	uint8_t row;
+
+	for(row = 0; row < HAT_HEIGHT; row++) {
+		gfx_SetColor(pal->base);
+		gfx_HorizLine(x + hatRows[row].start, y + row, hatRows[row].end - hatRows[row].start);
+
+		gfx_SetColor(themeColors.hatEdge);
+		if(row == 0) {
+			gfx_HorizLine(x + hatRows[row].start, y, hatRows[row].end - hatRows[row].start);
+		} else {
+			gfx_HorizLine(x + hatRows[row].start, y + row, start - hatRows[row].start);
+			gfx_HorizLine(x + end, y + row, hatRows[row].end - end);
+		}
+
+		start = hatRows[row].start;
+		end = hatRows[row].end;
+	}
+}
 
-#define COLOR_LIGHT_ALT 0xD6
+/* Point that csrOver is checked against, offscreen until it is set */
+static int24_t drawCsrX = -1;
+static int24_t drawCsrY = -1;
 
 uint24_t getMaxHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache);
 uint24_t getTotalHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache);
 uint24_t getMaxWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache);
 uint24_t getTotalHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache);
 
-/* Get a graphx color from a blockColor */
-uint8_t getColor(blockColor_t col) {
-	/* colors is a 16x4 sprite */
-	return colors->data[col];
-}
-
-/* Get a lighter color with the same hue */
-uint8_t getLightColor(blockColor_t col) {
-	/* If already the alt color, get the generic light color for alt colors */
-	if(col & COLOR_ALT) return COLOR_LIGHT_ALT;
-	/* Otherwise, get the value of the alt color */
-	return getColor(col | COLOR_ALT);
-}
-
-/* Get a darker color with the same hue */
-uint8_t getDarkColor(blockColor_t col) {
-	return getColor(col | COLOR_DARK);
-}
-
 /* Finds the tallest elem in a block */
 uint24_t getMaxHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 	uint24_t height = 8; /* If there are no elements taller than 8px, use 8px */
@@ -86,11 +97,14 @@ uint24_t getHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 
 	/* If we don't care about the next element, change next to point to some temp memory */
 	scriptElem_t *tmp;
+	bool wantNext = next != NULL;
 	if(!next) next = &tmp;
 	*next = elem + 1;
 
 	/* If there is already a cached version, just return that */
 	if(cache && *cache) {
+		/* Skip the subelements, ending up in the same place as working it out would */
+		if(wantNext) *next = getNext(elem);
 		return *cache;
 	}
 
@@ -124,7 +138,7 @@ uint24_t getHeight(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 
 		case BLOCK_RING_START: {
 			/* Get the total height of the inner blocks */
-			height = getTotalHeight(elem, next, cache) + 6;
+			height = getTotalHeight(elem, next, cache) + 2 * RING_PADDING;
 			if(height < 14) height = 14;
 			break;
 		}
@@ -189,11 +203,14 @@ uint24_t getWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 
 	/* If we don't care about the next element, change next to point to some temp memory */
 	scriptElem_t *tmp;
+	bool wantNext = next != NULL;
 	if(!next) next = &tmp;
 	*next = elem + 1;
 
 	/* If there is already a cached version, just return that */
 	if(cache && *cache) {
+		/* Skip the subelements, ending up in the same place as working it out would */
+		if(wantNext) *next = getNext(elem);
 		return *cache;
 	}
 
@@ -202,7 +219,7 @@ uint24_t getWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 
 	switch(elem->type) {
 		case STRING_LITERAL:
-			width = 4 + gfx_GetStringWidth(elem->data);
+			width = 4 + textWidth(elem->data);
 			break;
 
 		case BOOLEAN_LITERAL:
@@ -211,7 +228,7 @@ uint24_t getWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 			break;
 
 		case TITLE_TEXT:
-			width = gfx_GetStringWidth(elem->data);
+			width = textWidth(elem->data);
 			break;
 
 		case BLOCK_START: {
@@ -227,12 +244,12 @@ uint24_t getWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 		}
 
 		case ON_GREEN_FLAG: {
-			width = LEFT_MARGIN + RIGHT_MARGIN + gfx_GetStringWidth("when  clicked") + flag->width;
+			width = LEFT_MARGIN + RIGHT_MARGIN + textWidth("when  clicked") + flag->width;
 			break;
 		}
 
 		case BLOCK_RING_START: {
-			width = getMaxWidth(elem, next, cache) + 6;
+			width = getMaxWidth(elem, next, cache) + 2 * RING_PADDING;
 			break;
 		}
 
@@ -275,38 +292,35 @@ uint24_t getMaxWidth(scriptElem_t *elem, scriptElem_t **next, uint24_t *cache) {
 	return width;
 }
 
-/* Draw the funky hexagonal shape */
-/* capWidth is included in width */
-/* Credit to runer to making this actually symmetrical */
-void drawPredicateBg(int24_t x, int24_t y, uint24_t width, uint24_t height, uint24_t capWidth) {
-	uint24_t halfHeight = height / 2;
-	uint24_t doubleCapWidth = capWidth * 2;
-	int24_t xl = x;
-	int24_t xr = x + width;
-	uint24_t i;
-
-	/* Draw the caps */
-	for(i = 0; i < capWidth; i++) {
-		uint24_t halfSliceHeight = ((i * 2 + 1) * halfHeight + capWidth) / doubleCapWidth;
-		uint24_t sliceHeight = halfSliceHeight * 2 + (height & 1);
-		int24_t sliceY = y - halfSliceHeight;
-		gfx_VertLine(xl++, sliceY, sliceHeight);
-		gfx_VertLine(--xr, sliceY, sliceHeight);
+/* Whether an elem is positioned by its top rather than its center */
+static bool isTopAligned(uint8_t type) {
+	switch(type) {
+		case BLOCK_START:
+		case ON_GREEN_FLAG:
+		case ON_KEY:
+		case ON_CLICK:
+		case ON_CLONE:
+			return true;
+		default:
+			return false;
 	}
-
-	/* Draw the center of the hexagon */
-	gfx_FillRectangle(xl, y - halfHeight, xr - xl, height);
 }
 
-void drawReporterBg(int24_t x, int24_t y, uint24_t width, uint24_t height) {
-	uint24_t i;
+static bool inBox(int24_t pointX, int24_t pointY, int24_t x, int24_t top, uint24_t width, uint24_t height) {
+	return pointX >= x && pointX < x + (int24_t)width && pointY >= top && pointY < top + (int24_t)height;
+}
 
-	for(i = 0; i < 3; i++) {
-		gfx_HorizLine(x + 3 - i, y + i, width - 6 + 2 * i);
-		gfx_HorizLine(x + 3 - i, y + height - i - 1, width - 6 + 2 * i);
-	}
+/* Draw the funky hexagonal shape */
+/* capWidth is included in width */
+/* Credit to runer to making this actually symmetrical */
+void drawPredicateBg(int24_t x, int24_t y, uint24_t width, uint24_t height, uint24_t capWidth, const blockPalette_t *pal) {
+	shape_t *shape = getShape(SHAPE_PREDICATE, width, height, capWidth);
+	if(shape) drawShape(shape, x, y - height / 2, width, pal);
+}
 
-	gfx_FillRectangle(x, y + 3, width, height - 6);
+void drawReporterBg(int24_t x, int24_t y, uint24_t width, uint24_t height, const blockPalette_t *pal) {
+	shape_t *shape = getShape(SHAPE_REPORTER, width, height, 0);
+	if(shape) drawShape(shape, x, y, width, pal);
 }
 
 /* Draw all of the subelements of an element */
@@ -333,7 +347,7 @@ bool drawRecursiveElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t co
 	
 			/* Actually draw the subelement */
 			error = drawElem(
-				checkElem, subX, subY, col, &checkElem, NULL,
+				checkElem, subX, subY, col, &checkElem, csrOver,
 				widthCache ? widthCache + (checkElem - elem) : NULL,
 				heightCache ? heightCache + (checkElem - elem) : NULL
 			);
@@ -400,17 +414,20 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 	/* If the bottom right corner of the element is to the top left of the screen, return  */
 	if(x + width < 0 || y + height < 0) goto setNext;
 
+	if(csrOver && inBox(drawCsrX, drawCsrY, x, isTopAligned(elem->type) ? y : y - (int24_t)height / 2, width, height)) {
+		*csrOver = true;
+	}
+
 	switch(elem->type) {
 		case ON_GREEN_FLAG: {
-			blockColor_t col = CONTROL;
-			uint24_t subX;
+			const blockPalette_t *pal = &palette[CONTROL];
+			int24_t subX, textY;
 			int i;
-			/* Set the graphx color */
-			gfx_SetColor(getColor(col));
-
 			/* Draw the hat */
-			gfx_TransparentSprite(hat, x, y);
+			drawHat(x, y, pal);
+
 			/* Draw the box */
+			gfx_SetColor(pal->base);
 			gfx_FillRectangle(x, y + HAT_HEIGHT, width, height - HAT_HEIGHT - 1);
 			/* Make the block look rounded */
 			gfx_HorizLine(x + 1, y + height - 1, width - 2);
@@ -420,15 +437,15 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 				gfx_HorizLine(x + NOTCH_OFFSET + i, y + height + i, NOTCH_SIZE - 2 * i);
 			}
 
-			/* Add a white-ish border to the non-hat top surface for a smoother transition */
-			gfx_SetColor(0xCD);
+			/* Continue the hat's edge along the rest of the top surface for a smoother transition */
+			gfx_SetColor(themeColors.hatEdge);
 			gfx_HorizLine(x + HAT_MIN_WIDTH - 2, y + HAT_HEIGHT - 1, width - HAT_MIN_WIDTH + 1);
 
 			/* Draw text */
-			gfx_SetTextFGColor(gfx_white);
-			gfx_PrintStringXY("when ", x + LEFT_MARGIN, y + HAT_HEIGHT + (height - HAT_HEIGHT - TEXT_HEIGHT) / 2);
+			textY = y + HAT_HEIGHT + (height - HAT_HEIGHT - TEXT_HEIGHT) / 2;
+			drawText("when ", x + LEFT_MARGIN, textY, pal->text);
 
-			subX = gfx_GetTextX();
+			subX = x + LEFT_MARGIN + textWidth("when ");
 
 			/* Add the flag */
 			gfx_TransparentSprite(flag, subX, y + HAT_HEIGHT - 1);
@@ -436,7 +453,7 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 			/* Move the text cursor to the right of the flag */
 			subX += flag->width;
 
-			gfx_PrintStringXY(" clicked", subX, gfx_GetTextY());
+			drawText(" clicked", subX, textY, pal->text);
 
 			break;
 		}
@@ -450,39 +467,33 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 			gfx_SetColor(gfx_white);
 			gfx_FillRectangle(x + 1, y - (TEXT_HEIGHT / 2) - 1, width - 2, TEXT_HEIGHT + 2);
 
-			/* If the text will go offscreen, turn on text clipping */
-			if(x < 0 || x + width > LCD_WIDTH) {
-				gfx_SetTextConfig(gfx_text_clip);
-			}
-
 			/* Draw the actual text */
-			gfx_SetTextFGColor(gfx_black);
-			gfx_PrintStringXY(elem->data, x + 2, y - (TEXT_HEIGHT / 2));
-
-			/* Reset the text config */
-			gfx_SetTextConfig(gfx_text_noclip);
+			drawText(elem->data, x + 2, y - (TEXT_HEIGHT / 2), gfx_black);
 
 			break;
 		}
 
 		case BOOLEAN_LITERAL: {
+			blockPalette_t fill;
+
 			switch((uint24_t)elem->data) {
 				case 0:
-					gfx_SetColor(COLOR_FALSE);
+					fill.base = themeColors.boolFalse;
 					break;
 				case 1:
-					gfx_SetColor(COLOR_TRUE);
+					fill.base = themeColors.boolTrue;
 					break;
 				case 2: /* This is an empty predicate "slot" */
-					gfx_SetColor(getColor(parentColor | COLOR_DARK));
+					fill.base = palette[parentColor].dark;
 					break;
 			}
+			fill.light = fill.dark = fill.text = fill.base;
 
 			/* Draw the hexagon */
-			drawPredicateBg(x, y, width, 8, PRED_CAP_WIDTH / 2);
+			drawPredicateBg(x, y, width, 8, PRED_CAP_WIDTH / 2, &fill);
 
 			/* Draw the circle at the end of the selector */
-			gfx_SetColor(COLOR_BOOL_SELECT);
+			gfx_SetColor(themeColors.boolSelect);
 			if((uint24_t)elem->data == 0) {
 				gfx_FillCircle(x + 8 / 2, y, 8 / 2);
 			} else if((uint24_t)elem->data == 1) {
@@ -493,78 +504,22 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 		}
 
 		case TITLE_TEXT: {
-			/* Use black text on lighter blocks only */
-			if(parentColor & COLOR_ALT) {
-				gfx_SetTextFGColor(gfx_black);
-			} else {
-				gfx_SetTextFGColor(gfx_white);
-			}
-
-			/* If the text will go offscreen, turn on text clipping */
-			/* Seems somewhat broken, but only for one color? TODO: investigate */
-			if(x < 0 || x + width > LCD_WIDTH) {
-				gfx_SetTextConfig(gfx_text_clip);
-			}
-
-			/* Draw the actual text */
-			gfx_PrintStringXY(elem->data, x, y - TEXT_HEIGHT / 2);
-
-			/* Reset the text config */
-			gfx_SetTextConfig(gfx_text_noclip);
+			/* Clipped by glyph, since graphx's text clipping doesn't work with every color */
+			drawText(elem->data, x, y - TEXT_HEIGHT / 2, palette[parentColor].text);
 
 			break;
 		}
 
 		case BLOCK_START: {
-			/* Allocate a temporary sprite to store the inverted notch contents in */
-			gfx_UninitedSprite(tmpSprite, NOTCH_SIZE, NOTCH_DEPTH);
-			int i;
+			shape_t *shape;
 
-			/* Get the graphx color based on the appropriate category and parent color */
+			/* Get the graphx colors based on the appropriate category and parent color */
 			blockColor_t col = getCategory(elem->data);
 			if(col == parentColor) col |= COLOR_ALT;
-			gfx_SetColor(getColor(col));
-
-			/* Set the sprite size */
-			tmpSprite->width  = NOTCH_SIZE;
-			tmpSprite->height = NOTCH_DEPTH;
-
-			/* Copy the background from where the inverted notch will be */
-			gfx_GetSprite(tmpSprite, x + NOTCH_OFFSET, y);
-
-			/* Draw a rounded rectangle */
-			gfx_SetColor(getLightColor(col));
-			gfx_HorizLine(x + 1, y, width - 2);
-			gfx_VertLine(x, y + 1, height - 2);
-
-			gfx_SetColor(getDarkColor(col));
-			gfx_HorizLine(x + 1, y + height - 1, NOTCH_OFFSET - 1);
-			gfx_HorizLine(x + NOTCH_OFFSET + NOTCH_SIZE, y + height - 1, width - 1 - (NOTCH_OFFSET + NOTCH_SIZE));
-			gfx_VertLine(x + width - 1, y + 1, height - 2);
-
-			gfx_SetColor(getColor(col));
-			gfx_FillRectangle(x + 1, y + 1, width - 2, height - 2);
-			gfx_HorizLine(x + NOTCH_OFFSET, y + height - 1, NOTCH_SIZE);
-
-			/* Replace the background, leaving a rectangular notch */
-			gfx_Sprite(tmpSprite, x + NOTCH_OFFSET, y);
 
-			for(i = 0; i < NOTCH_DEPTH; i++) {
-				gfx_SetColor(getColor(col));
-				/* Draw the corners of the inverted notch */
-				gfx_HorizLine(x + NOTCH_OFFSET + 1, y + i, i - 1);
-				gfx_HorizLine(x + NOTCH_OFFSET + NOTCH_SIZE - i, y + i, i);
-
-				/* Draw the regular notch */
-				if(i == NOTCH_DEPTH - 1) gfx_SetColor(getDarkColor(col));
-				gfx_HorizLine(x + NOTCH_OFFSET + i, y + height + i, NOTCH_SIZE - 2 * i - 1);
-			
-				gfx_SetColor(getLightColor(col));
-				gfx_SetPixel(x + NOTCH_OFFSET + i - 1, y + i);
-
-				gfx_SetColor(getDarkColor(col));
-				gfx_SetPixel(x + NOTCH_OFFSET + NOTCH_SIZE - 1 - i, y + height + i);
-			}
+			/* Draw the block, with its edges and notches */
+			shape = getShape(SHAPE_BLOCK, width, height, 0);
+			if(shape) drawShape(shape, x, y, width, &palette[col]);
 
 			/* Draw the block's subelements */
 			drawRecursiveElem(elem, x + LEFT_MARGIN, y + height / 2, col, next, csrOver, widthCache, heightCache);
@@ -576,10 +531,9 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 			/* Get the graphx color based on the appropriate category and parent color */
 			blockColor_t col = getCategory(elem->data);
 			if(col == parentColor) col |= COLOR_ALT;
-			gfx_SetColor(getColor(col));
 
 			/* Draw the hexagon */
-			drawPredicateBg(x, y, width, height, PRED_CAP_WIDTH);
+			drawPredicateBg(x, y, width, height, PRED_CAP_WIDTH, &palette[col]);
 
 			/* Draw the predicate's subelements */
 			drawRecursiveElem(elem, x + PRED_CAP_WIDTH + 1, y, col, next, csrOver, widthCache, heightCache);
@@ -590,11 +544,10 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 		case BLOCK_RING_START: {
 			blockColor_t col = OTHER;
 			if(col == parentColor) col |= COLOR_ALT;
-			gfx_SetColor(getColor(col));
 
-			drawReporterBg(x, y - height / 2, width, height);
+			drawReporterBg(x, y - height / 2, width, height, &palette[col]);
 
-			drawRecursiveElem(elem, x + 3, y - height / 2 + 3, col, next, csrOver, widthCache, heightCache);
+			drawRecursiveElem(elem, x + RING_PADDING, y - height / 2 + RING_PADDING, col, next, csrOver, widthCache, heightCache);
 
 			goto success;
 		}
@@ -602,7 +555,8 @@ bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor
 
 	setNext:
 
-	if(next) *next = getNext(elem);
+	/* Skip past the BLOCK_END, the same as drawRecursiveElem does */
+	if(next) *next = getNextSibling(elem);
 
 	success:
 
@@ -648,7 +602,7 @@ bool drawScript(scriptElem_t *elem, int24_t x, int24_t y, bool *csrOver, uint24_
 			subHeight = getHeight(checkElem, NULL, heightCache + (checkElem - elem));
 	
 			/* Draw the block */
-			error = drawElem(checkElem, x, subY, 0, &checkElem, NULL, widthCache + (checkElem - elem), heightCache + (checkElem - elem));
+			error = drawElem(checkElem, x, subY, 0, &checkElem, csrOver, widthCache + (checkElem - elem), heightCache + (checkElem - elem));
 	
 			if(!error) {
 				if(freeWidth) free(widthCache);
@@ -670,3 +624,174 @@ bool drawScript(scriptElem_t *elem, int24_t x, int24_t y, bool *csrOver, uint24_
 
 	return true;
 }
+
+void setDrawCursor(int24_t x, int24_t y) {
+	drawCsrX = x;
+	drawCsrY = y;
+}
+
+/* Get the length of an element, from the cache if possible */
+static uint24_t getCachedLength(scriptElem_t *elem, uint24_t *cache) {
+	if(!*cache) *cache = getLength(elem);
+	return *cache;
+}
+
+/* Get the element after elem and its subelements, from the length cache */
+static scriptElem_t *getCachedSibling(scriptElem_t *elem, uint24_t *lengthCache) {
+	scriptElem_t *next = elem + getCachedLength(elem, lengthCache);
+	if(next->type == BLOCK_END && next->data == (void*)elem) next++;
+	return next;
+}
+
+static scriptElem_t *hitTestElem(scriptElem_t *elem, int24_t x, int24_t y, int24_t csrX, int24_t csrY, uint24_t *widthCache, uint24_t *heightCache, uint24_t *lengthCache);
+
+/* Find the subelement of elem under a point, placing each one the same way as drawRecursiveElem */
+static scriptElem_t *hitTestChildren(scriptElem_t *elem, int24_t x, int24_t y, int24_t csrX, int24_t csrY, uint24_t *widthCache, uint24_t *heightCache, uint24_t *lengthCache) {
+	int24_t subX = x;
+	int24_t subY = y;
+	scriptElem_t *checkElem = elem + 1;
+
+	while(checkElem->type != END_SCRIPT) {
+		uint24_t offset = checkElem - elem;
+		uint24_t subWidth, subHeight;
+		int24_t top;
+
+		/* Break if we are at the end of the block */
+		if(checkElem->type == BLOCK_END && checkElem->data == (void*)elem) break;
+
+		subWidth = getWidth(checkElem, NULL, widthCache + offset);
+		subHeight = getHeight(checkElem, NULL, heightCache + offset);
+		top = isTopAligned(checkElem->type) ? subY : subY - (int24_t)subHeight / 2;
+
+		/* Subelements don't overlap, so this is the only one worth looking inside */
+		if(inBox(csrX, csrY, subX, top, subWidth, subHeight)) {
+			return hitTestElem(checkElem, subX, subY, csrX, csrY, widthCache + offset, heightCache + offset, lengthCache + offset);
+		}
+
+		if(checkElem->type == BLOCK_START) {
+			subY += subHeight;
+		} else {
+			subX += subWidth + ARG_SPACING;
+		}
+
+		checkElem = getCachedSibling(checkElem, lengthCache + offset);
+	}
+
+	return NULL;
+}
+
+/* Get where drawElem starts drawing an element's subelements */
+/* Returns false if the element doesn't have any drawn subelements */
+static bool getChildOrigin(scriptElem_t *elem, int24_t x, int24_t y, uint24_t height, int24_t *subX, int24_t *subY) {
+	switch(elem->type) {
+		case BLOCK_START:
+			*subX = x + LEFT_MARGIN;
+			*subY = y + height / 2;
+			return true;
+		case PREDICATE_START:
+			*subX = x + PRED_CAP_WIDTH + 1;
+			*subY = y;
+			return true;
+		case BLOCK_RING_START:
+			*subX = x + RING_PADDING;
+			*subY = y - height / 2 + RING_PADDING;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Find the deepest element under a point, given that the point is inside elem */
+static scriptElem_t *hitTestElem(scriptElem_t *elem, int24_t x, int24_t y, int24_t csrX, int24_t csrY, uint24_t *widthCache, uint24_t *heightCache, uint24_t *lengthCache) {
+	scriptElem_t *hit = NULL;
+	int24_t subX, subY;
+
+	if(getChildOrigin(elem, x, y, getHeight(elem, NULL, heightCache), &subX, &subY)) {
+		hit = hitTestChildren(elem, subX, subY, csrX, csrY, widthCache, heightCache, lengthCache);
+	}
+
+	/* If the point is between subelements, it's over the element itself */
+	return hit ? hit : elem;
+}
+
+scriptElem_t *hitTest(scriptElem_t *script, int24_t x, int24_t y, int24_t csrX, int24_t csrY, uint24_t *widthCache, uint24_t *heightCache, uint24_t *lengthCache) {
+	int24_t subY = y;
+	scriptElem_t *checkElem = script;
+
+	/* Blocks are stacked the same way as in drawScript */
+	while(checkElem->type != END_SCRIPT && subY <= csrY) {
+		uint24_t offset = checkElem - script;
+		uint24_t width = getWidth(checkElem, NULL, widthCache + offset);
+		uint24_t height = getHeight(checkElem, NULL, heightCache + offset);
+
+		if(inBox(csrX, csrY, x, subY, width, height)) {
+			return hitTestElem(checkElem, x, subY, csrX, csrY, widthCache + offset, heightCache + offset, lengthCache + offset);
+		}
+
+		subY += height;
+		checkElem = getCachedSibling(checkElem, lengthCache + offset);
+	}
+
+	return NULL;
+}
+
+static scriptElem_t *layoutElem(scriptElem_t *elem, scriptElem_t *parent, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache, layoutFunc_t func, void *data);
+
+/* Lay out the subelements of elem, the same way as drawRecursiveElem */
+/* Returns the element after elem's BLOCK_END */
+static scriptElem_t *layoutChildren(scriptElem_t *elem, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache, layoutFunc_t func, void *data) {
+	int24_t subX = x;
+	int24_t subY = y;
+	scriptElem_t *checkElem = elem + 1;
+
+	while(checkElem->type != END_SCRIPT) {
+		uint24_t offset = checkElem - elem;
+		uint24_t subWidth, subHeight;
+		uint8_t type = checkElem->type;
+
+		/* Point at the element after BLOCK_END */
+		if(type == BLOCK_END && checkElem->data == (void*)elem) return checkElem + 1;
+
+		subWidth = getWidth(checkElem, NULL, widthCache + offset);
+		subHeight = getHeight(checkElem, NULL, heightCache + offset);
+
+		checkElem = layoutElem(checkElem, elem, subX, subY, widthCache + offset, heightCache + offset, func, data);
+
+		if(type == BLOCK_START) {
+			subY += subHeight;
+		} else {
+			subX += subWidth + ARG_SPACING;
+		}
+	}
+
+	return checkElem;
+}
+
+/* Lay out an element and everything in it, returning the element after it */
+static scriptElem_t *layoutElem(scriptElem_t *elem, scriptElem_t *parent, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache, layoutFunc_t func, void *data) {
+	uint24_t width = getWidth(elem, NULL, widthCache);
+	uint24_t height = getHeight(elem, NULL, heightCache);
+	int24_t subX, subY;
+
+	func(elem, parent, x, isTopAligned(elem->type) ? y : y - (int24_t)height / 2, width, height, data);
+
+	if(getChildOrigin(elem, x, y, height, &subX, &subY)) {
+		return layoutChildren(elem, subX, subY, widthCache, heightCache, func, data);
+	}
+
+	return getNextSibling(elem);
+}
+
+void layoutScript(scriptElem_t *script, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache, layoutFunc_t func, void *data) {
+	int24_t subY = y;
+	scriptElem_t *checkElem = script;
+
+	/* Blocks are stacked the same way as in drawScript */
+	while(checkElem->type != END_SCRIPT) {
+		uint24_t offset = checkElem - script;
+		uint24_t height = getHeight(checkElem, NULL, heightCache + offset);
+
+		checkElem = layoutElem(checkElem, NULL, x, subY, widthCache + offset, heightCache + offset, func, data);
+		subY += height;
+	}
+}
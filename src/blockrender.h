@@ -13,6 +13,11 @@
 
 #include "script.h"
 
+#define NOTCH_DEPTH		  3 // Height of the notch on a block
+#define NOTCH_OFFSET	 10 // Pixels from the left of a block before the notch starts
+#define NOTCH_SIZE		(10 + 2 * NOTCH_DEPTH) // Width of the notch, including the sloped sides
+#define RING_PADDING	  3 // Space between the edge of a ring and the blocks inside it
+
 /* Get the height of an element */
 /* next will be set to the pointer to the next element, if non-null */
 /* Cache is a height cache, which should be, if non-NULL, at least the length of the element */
@@ -36,9 +41,28 @@ typedef uint8_t blockColor_t;
 /* Returns false if error */
 /* Parent color */
 /* next will be set to the pointer to the next element, if non-null */
-/* csrOver is currently unused */
+/* If csrOver is non-null, it is set to true if the draw cursor is over anything drawn, and left as it is otherwise */
 /* widthCache and heightCache are caches, which, if non-null, should be at least the length of the element */
 bool drawElem(scriptElem_t *elem, int24_t x, int24_t y, blockColor_t parentColor, scriptElem_t **next, bool *csrOver, uint24_t *widthCache, uint24_t *heightCache);
 bool drawScript(scriptElem_t *elem, int24_t x, int24_t y, bool *csrOver, uint24_t *widthCache, uint24_t *heightCache);
 
+/* Set the point that csrOver is checked against when drawing */
+void setDrawCursor(int24_t x, int24_t y);
+
+/* Find the deepest element under a point, in a script drawn with its top left corner at x, y */
+/* Only the elements whose boxes contain the point are descended into */
+/* widthCache and heightCache are the ones the script is drawn with */
+/* lengthCache holds the length of each element, and should start out zeroed */
+/* All three caches should be non-null, and at least the length of the script */
+/* Returns NULL if the point isn't over the script */
+scriptElem_t *hitTest(scriptElem_t *script, int24_t x, int24_t y, int24_t csrX, int24_t csrY, uint24_t *widthCache, uint24_t *heightCache, uint24_t *lengthCache);
+
+/* Called for every element laid out by layoutScript, in script order */
+/* top is the top of the element's box, and parent is NULL for the blocks at the top of the script */
+typedef void (*layoutFunc_t)(scriptElem_t *elem, scriptElem_t *parent, int24_t x, int24_t top, uint24_t width, uint24_t height, void *data);
+
+/* Work out where every element in a script goes, if it were drawn with its top left corner at x, y */
+/* widthCache and heightCache are the ones the script is drawn with, and should be non-null */
+void layoutScript(scriptElem_t *script, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache, layoutFunc_t func, void *data);
+
 #endif
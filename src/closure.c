@@ -0,0 +1,162 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "closure.h"
+
+#define closureSize(numSlots) (sizeof(closure_t) + ((numSlots) - 1) * sizeof(binding_t))
+
+static binding_t *findSlot(closure_t *closure, variable_t *var) {
+	uint8_t i;
+	for(i = 0; i < closure->numSlots; i++) {
+		if(closure->slots[i].var == var) return &closure->slots[i];
+	}
+	return NULL;
+}
+
+/* Move a binding's value into a box, if it isn't in one already */
+/* Returns false if out of memory */
+static bool boxBinding(thread_t *thread, binding_t *binding) {
+	box_t *box;
+
+	if(binding->box) return true;
+
+	box = gcAlloc(GC_BOX, sizeof(box_t));
+	if(!box) return false;
+
+	/* The box can outlive the region */
+	/* It starts out black while marking, but locals aren't barriered, so the value might not have been seen yet */
+	box->value = execKeep(thread, binding->value);
+	gcWriteBarrier(box);
+	binding->box = box;
+	binding->value = noneValue();
+
+	return true;
+}
+
+closure_t *closureNew(thread_t *thread, scriptElem_t *ring) {
+	scriptElem_t *end = getNext(ring);
+	scriptElem_t *elem;
+	closure_t *closure;
+	uint24_t start = regionMark(&thread->region);
+	uint24_t maxSlots = 1;
+
+	/* Count the slots we might need, to avoid resizing later */
+	for(elem = ring + 1; elem < end; elem++) {
+		if(elem->type == VARIABLE || elem->type == UPVAR) maxSlots++;
+	}
+	if(maxSlots > CLOSURE_MAX_SLOTS) {
+		dbg_sprintf(dbgerr, "Ring %p refers to too many variables, some won't be captured\n", ring);
+		maxSlots = CLOSURE_MAX_SLOTS;
+	}
+
+	closure = regionAlloc(&thread->region, closureSize(maxSlots));
+	if(!closure) return NULL;
+
+	closure->gc.type = GC_REGION;
+	closure->ring = ring;
+	closure->numSlots = 0;
+
+	/* The ring's formal parameters come first, as upvars in an arglist */
+	elem = ring + 1;
+	if(elem->type == ARGLIST_START) {
+		for(elem++; elem->type == UPVAR && closure->numSlots < maxSlots; elem++) {
+			closure->slots[closure->numSlots].var = (variable_t*)elem->data;
+			closure->slots[closure->numSlots].value = noneValue();
+			closure->slots[closure->numSlots].box = NULL;
+			closure->numSlots++;
+		}
+	}
+	closure->numParams = closure->numSlots;
+
+	/* Capture the local variables that are referred to */
+	/* Globals don't need capturing, since they are looked up the same way everywhere */
+	for(; elem < end && closure->numSlots < maxSlots; elem++) {
+		variable_t *var = (variable_t*)elem->data;
+		binding_t *binding;
+
+		if(elem->type != VARIABLE || findSlot(closure, var)) continue;
+
+		binding = envFind(thread->env, var);
+		if(!binding) continue;
+
+		if(!boxBinding(thread, binding)) {
+			regionRelease(&thread->region, start);
+			return NULL;
+		}
+		closure->slots[closure->numSlots++] = *binding;
+	}
+
+	/* Give back the slots we didn't need */
+	regionRelease(&thread->region, start + closureSize(closure->numSlots ? closure->numSlots : 1));
+
+	return closure;
+}
+
+closure_t *closureCopyToHeap(thread_t *thread, closure_t *closure) {
+	size_t size = closureSize(closure->numSlots ? closure->numSlots : 1);
+	closure_t *copy = gcAlloc(GC_CLOSURE, size);
+	uint8_t i;
+
+	if(!copy) return NULL;
+
+	/* Copy everything but the header */
+	memcpy(&copy->ring, &closure->ring, size - offsetof(closure_t, ring));
+
+	/* Captured variables are already in boxes on the heap, but any rings in the slots need to be moved too */
+	for(i = 0; i < copy->numSlots; i++) {
+		copy->slots[i].value = execKeep(thread, copy->slots[i].value);
+	}
+	gcWriteBarrier(copy);
+
+	return copy;
+}
+
+value_t closureCall(thread_t *thread, closure_t *closure, value_t *args, uint8_t argc) {
+	uint24_t mark = regionMark(&thread->region);
+	env_t *savedEnv = thread->env;
+	scriptElem_t *body = closure->ring + 1;
+	env_t *env;
+	value_t result;
+	uint8_t i;
+
+	/* Command rings need the executor */
+	if(closure->ring->type == BLOCK_RING_START) return noneValue();
+
+	/* Skip over the formal parameters */
+	if(body->type == ARGLIST_START) body = getNextSibling(body);
+
+	/* An empty ring reports nothing */
+	if(body->type == BLOCK_END) return noneValue();
+
+	/* Copy the slots, so that the closure can be called again or recursively */
+	/* Captured variables stay shared, since the copies point to the same boxes */
+	env = regionAlloc(&thread->region, sizeof(env_t) + closure->numSlots * sizeof(binding_t));
+	if(!env) return noneValue();
+	env->slots = (binding_t*)(env + 1);
+	env->count = closure->numSlots;
+	memcpy(env->slots, closure->slots, closure->numSlots * sizeof(binding_t));
+
+	/* Bind the arguments */
+	for(i = 0; i < argc && i < closure->numParams; i++) {
+		env->slots[i].value = args[i];
+	}
+
+	thread->env = env;
+	result = execEval(thread, body);
+	thread->env = savedEnv;
+
+	/* The result might be in the part of the region we are about to release */
+	result = execKeep(thread, result);
+	regionRelease(&thread->region, mark);
+
+	return result;
+}
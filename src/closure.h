@@ -0,0 +1,53 @@
+#ifndef H_CLOSURE
+#define H_CLOSURE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "value.h"
+#include "exec.h"
+#include "gc.h"
+
+/* Most slots a closure can have, since they are counted in a byte */
+#define CLOSURE_MAX_SLOTS 255
+
+/* A local variable that a ring has captured */
+/* The binding it came from and every closure that captured it share the box, so setting it is seen by all of them */
+typedef struct Box {
+	gcHeader_t gc;
+	value_t value;
+} box_t;
+
+/* The runtime version of a ring */
+/* Only the local variables that the ring refers to are captured, by reference through a box */
+/* Closures in a region have a gc type of GC_REGION, and are never collected */
+typedef struct Closure {
+	gcHeader_t gc;
+	scriptElem_t *ring;	/* The ring elem, followed by its contents */
+	uint8_t numParams;	/* Formal parameters, which are the first slots */
+	uint8_t numSlots;	/* Parameters plus captured variables */
+	binding_t slots[1];	/* Actually numSlots long */
+} closure_t;
+
+/* Evaluate a ring, allocating the closure in the thread's region */
+/* Captured variables are moved into boxes on the heap, where they stay */
+/* Returns NULL if the region is full or out of memory */
+closure_t *closureNew(thread_t *thread, scriptElem_t *ring);
+
+/* Copy a closure out of a region onto the garbage collected heap */
+/* Returns NULL if out of memory */
+closure_t *closureCopyToHeap(thread_t *thread, closure_t *closure);
+
+/* Call a reporter or predicate ring with some arguments */
+/* The environment is allocated in the thread's region and released afterwards */
+value_t closureCall(thread_t *thread, closure_t *closure, value_t *args, uint8_t argc);
+
+#endif
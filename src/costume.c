@@ -0,0 +1,113 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+#include <decompress.h>
+#include <debug.h>
+
+#include "costume.h"
+
+typedef struct CostumeEntry {
+	const costume_t *costume;
+	gfx_sprite_t *sprite;	/* NULL if the slot is empty */
+	uint24_t lastUsed;
+} costumeEntry_t;
+
+costumeStats_t costumeStats;
+
+static costumeEntry_t cache[COSTUME_CACHE_SLOTS];
+static uint24_t useCount;
+
+static void evict(costumeEntry_t *entry) {
+	costumeStats.cachedBytes -= costumeSize(entry->costume);
+	free(entry->sprite);
+	entry->sprite = NULL;
+	entry->costume = NULL;
+}
+
+/* Throw away the least recently used costume, returning its slot */
+static costumeEntry_t *evictOldest(void) {
+	costumeEntry_t *oldest = NULL;
+	uint8_t i;
+
+	for(i = 0; i < COSTUME_CACHE_SLOTS; i++) {
+		costumeEntry_t *entry = &cache[i];
+		if(entry->sprite && (!oldest || entry->lastUsed < oldest->lastUsed)) oldest = entry;
+	}
+
+	if(oldest) evict(oldest);
+	return oldest;
+}
+
+gfx_sprite_t *getCostume(const costume_t *costume) {
+	costumeEntry_t *slot = NULL;
+	uint24_t size = costumeSize(costume);
+	uint24_t start;
+	uint8_t i;
+
+	/* Uncompressed costumes can be used where they are */
+	if(!costume->compressed) return (gfx_sprite_t*)costume->data;
+
+	useCount++;
+
+	for(i = 0; i < COSTUME_CACHE_SLOTS; i++) {
+		costumeEntry_t *entry = &cache[i];
+		if(entry->sprite && entry->costume == costume) {
+			entry->lastUsed = useCount;
+			costumeStats.hits++;
+			return entry->sprite;
+		}
+		if(!entry->sprite && !slot) slot = entry;
+	}
+
+	costumeStats.misses++;
+
+	if(size > COSTUME_CACHE_BYTES) {
+		dbg_sprintf(dbgerr, "Costume of %u bytes is too big to cache\n", size);
+		return NULL;
+	}
+
+	/* Make room for it */
+	while(!slot || costumeStats.cachedBytes + size > COSTUME_CACHE_BYTES) {
+		costumeEntry_t *freed = evictOldest();
+		if(!slot) slot = freed;
+	}
+
+	slot->sprite = malloc(size);
+	/* The heap might be short of memory even if the cache isn't, so try again without the other costumes */
+	while(!slot->sprite && evictOldest()) {
+		slot->sprite = malloc(size);
+	}
+	if(!slot->sprite) return NULL;
+
+	start = timer_1_Counter;
+	dzx7_Turbo((void*)costume->data, slot->sprite);
+	costumeStats.decompressTicks += timer_1_Counter - start;
+
+	slot->costume = costume;
+	slot->lastUsed = useCount;
+	costumeStats.cachedBytes += size;
+
+	return slot->sprite;
+}
+
+void costumeFreeCache(void) {
+	uint8_t i;
+
+	for(i = 0; i < COSTUME_CACHE_SLOTS; i++) {
+		if(cache[i].sprite) evict(&cache[i]);
+	}
+}
+
+void costumePrintStats(void) {
+	dbg_sprintf(dbgout, "costumes: %u hits, %u misses, %u ticks decompressing\n",
+		costumeStats.hits, costumeStats.misses, costumeStats.decompressTicks);
+	dbg_sprintf(dbgout, "costume cache: %u of %u bytes\n", costumeStats.cachedBytes, COSTUME_CACHE_BYTES);
+}
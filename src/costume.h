@@ -0,0 +1,52 @@
+#ifndef H_COSTUME
+#define H_COSTUME
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+/* Number of costumes that are kept decompressed at once */
+#define COSTUME_CACHE_SLOTS 8
+/* Most bytes of RAM used by decompressed costumes */
+#define COSTUME_CACHE_BYTES 8192
+
+/* A costume as it is stored in the project */
+typedef struct Costume {
+	const void *data;	/* gfx_sprite_t, zx7 compressed if compressed is set */
+	uint8_t width;		/* Known ahead of time, so that it doesn't have to be decompressed to find its size */
+	uint8_t height;
+	bool compressed;
+} costume_t;
+
+/* Bytes taken by a costume once it's decompressed */
+#define costumeSize(costume) (2 + (uint24_t)(costume)->width * (costume)->height)
+
+typedef struct CostumeStats {
+	uint24_t hits;				/* Lookups that found the costume already decompressed */
+	uint24_t misses;			/* Lookups that had to decompress it */
+	uint24_t decompressTicks;	/* Total time spent decompressing, in 32768 Hz timer ticks */
+	uint24_t cachedBytes;		/* Bytes used by the costumes in the cache */
+} costumeStats_t;
+
+extern costumeStats_t costumeStats;
+
+/* Get a costume as a sprite, decompressing it if it isn't in the cache */
+/* The least recently used costumes are freed to make room */
+/* The sprite is only valid until the next call */
+/* Returns NULL if out of memory, or if the costume is too big for the cache */
+gfx_sprite_t *getCostume(const costume_t *costume);
+
+/* Free every cached costume */
+void costumeFreeCache(void);
+
+void costumePrintStats(void);
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+#include <debug.h>
+
+#include "dirty.h"
+
+#define RIGHT(rect) ((rect)->x + (int24_t)(rect)->width)
+#define BOTTOM(rect) ((rect)->y + (int24_t)(rect)->height)
+
+static bool overlaps(const rect_t *rect, int24_t x, int24_t y, uint24_t width, uint24_t height) {
+	return x < RIGHT(rect) && x + (int24_t)width > rect->x && y < BOTTOM(rect) && y + (int24_t)height > rect->y;
+}
+
+/* Grow a rectangle to cover another one */
+static void merge(rect_t *rect, const rect_t *other) {
+	int24_t right = RIGHT(rect) > RIGHT(other) ? RIGHT(rect) : RIGHT(other);
+	int24_t bottom = BOTTOM(rect) > BOTTOM(other) ? BOTTOM(rect) : BOTTOM(other);
+
+	if(other->x < rect->x) rect->x = other->x;
+	if(other->y < rect->y) rect->y = other->y;
+	rect->width = right - rect->x;
+	rect->height = bottom - rect->y;
+}
+
+/* Area a rectangle would gain by being merged with another one */
+static uint24_t mergeCost(const rect_t *rect, const rect_t *other) {
+	rect_t merged = *rect;
+
+	merge(&merged, other);
+	return merged.width * merged.height - rect->width * rect->height;
+}
+
+/* Take a rectangle out of the list, without keeping the rest in order */
+static void removeRect(dirtyList_t *list, uint8_t i) {
+	list->rects[i] = list->rects[--list->numRects];
+}
+
+void dirtyAdd(dirtyList_t *list, int24_t x, int24_t y, uint24_t width, uint24_t height) {
+	rect_t rect;
+	uint8_t i;
+	uint8_t best;
+	uint24_t cost;
+	uint24_t bestCost;
+
+	/* Clip to the screen */
+	if(x < 0) {
+		if(width <= (uint24_t)-x) return;
+		width += x;
+		x = 0;
+	}
+	if(y < 0) {
+		if(height <= (uint24_t)-y) return;
+		height += y;
+		y = 0;
+	}
+	if(x >= LCD_WIDTH || y >= LCD_HEIGHT || !width || !height) return;
+	if(x + width > LCD_WIDTH) width = LCD_WIDTH - x;
+	if(y + height > LCD_HEIGHT) height = LCD_HEIGHT - y;
+
+	rect.x = x;
+	rect.y = y;
+	rect.width = width;
+	rect.height = height;
+
+	/* Absorb anything it overlaps, which might make it overlap something else */
+	for(i = 0; i < list->numRects;) {
+		rect_t *other = &list->rects[i];
+		if(overlaps(other, rect.x, rect.y, rect.width, rect.height)) {
+			merge(&rect, other);
+			removeRect(list, i);
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+
+	if(list->numRects < DIRTY_MAX_RECTS) {
+		list->rects[list->numRects++] = rect;
+		return;
+	}
+
+	/* Out of room, so grow whichever rectangle it adds the least area to */
+	best = 0;
+	bestCost = mergeCost(&list->rects[0], &rect);
+	for(i = 1; i < list->numRects; i++) {
+		cost = mergeCost(&list->rects[i], &rect);
+		if(cost < bestCost) {
+			best = i;
+			bestCost = cost;
+		}
+	}
+
+	/* The grown rectangle might overlap others now, so add it again */
+	merge(&rect, &list->rects[best]);
+	removeRect(list, best);
+	dirtyAdd(list, rect.x, rect.y, rect.width, rect.height);
+}
+
+bool dirtyIntersects(const dirtyList_t *list, int24_t x, int24_t y, uint24_t width, uint24_t height) {
+	uint8_t i;
+
+	for(i = 0; i < list->numRects; i++) {
+		if(overlaps(&list->rects[i], x, y, width, height)) return true;
+	}
+
+	return false;
+}
+
+void dirtyBlit(const dirtyList_t *list) {
+	uint8_t i;
+
+	for(i = 0; i < list->numRects; i++) {
+		const rect_t *rect = &list->rects[i];
+		gfx_BlitRectangle(gfx_buffer, rect->x, rect->y, rect->width, rect->height);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef H_DIRTY
+#define H_DIRTY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Most rectangles kept apart before they start being merged together */
+#define DIRTY_MAX_RECTS 8
+
+typedef struct Rect {
+	int24_t x;
+	int24_t y;
+	uint24_t width;
+	uint24_t height;
+} rect_t;
+
+/* The parts of the screen that have to be redrawn this frame */
+/* Rectangles are clipped to the screen, and overlapping ones are merged */
+typedef struct DirtyList {
+	rect_t rects[DIRTY_MAX_RECTS];
+	uint8_t numRects;
+} dirtyList_t;
+
+#define dirtyClear(list) ((list)->numRects = 0)
+
+/* Mark part of the screen as needing to be redrawn */
+void dirtyAdd(dirtyList_t *list, int24_t x, int24_t y, uint24_t width, uint24_t height);
+
+/* Whether any part of a rectangle is dirty */
+bool dirtyIntersects(const dirtyList_t *list, int24_t x, int24_t y, uint24_t width, uint24_t height);
+
+/* Copy the dirty parts of the buffer to the screen, instead of swapping the whole thing */
+void dirtyBlit(const dirtyList_t *list);
+
+#endif
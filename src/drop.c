@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "drop.h"
+#include "blockrender.h"
+
+#define CELL(coord) ((coord) >> DROP_CELL_SHIFT)
+#define BUCKET(cellX, cellY) (((uint24_t)(cellX) * 31 + (uint24_t)(cellY)) & (DROP_NUM_BUCKETS - 1))
+
+/* Passed through layoutScript to addTargets */
+typedef struct DropBuild {
+	dropIndex_t *index;
+	scriptElem_t *script;
+	bool ok;
+} dropBuild_t;
+
+bool dropInit(dropIndex_t *index) {
+	index->targets = malloc(DROP_INITIAL_CAPACITY * sizeof(dropTarget_t));
+	index->capacity = DROP_INITIAL_CAPACITY;
+	dropClear(index);
+	return index->targets != NULL;
+}
+
+void dropFree(dropIndex_t *index) {
+	free(index->targets);
+	index->targets = NULL;
+	index->numTargets = 0;
+	index->capacity = 0;
+}
+
+void dropClear(dropIndex_t *index) {
+	uint8_t i;
+
+	index->numTargets = 0;
+	for(i = 0; i < DROP_NUM_BUCKETS; i++) {
+		index->buckets[i] = -1;
+	}
+}
+
+/* Push a target onto the front of the bucket for its position */
+static void linkTarget(dropIndex_t *index, uint24_t i) {
+	dropTarget_t *target = &index->targets[i];
+	uint8_t bucket = BUCKET(CELL(target->x), CELL(target->y));
+
+	target->next = index->buckets[bucket];
+	index->buckets[bucket] = i;
+}
+
+static bool addTarget(dropIndex_t *index, uint8_t kind, scriptElem_t *script, scriptElem_t *elem, int24_t x, int24_t y) {
+	dropTarget_t *target;
+
+	if(index->numTargets == index->capacity) {
+		dropTarget_t *targets = realloc(index->targets, 2 * index->capacity * sizeof(dropTarget_t));
+		if(!targets) return false;
+		index->targets = targets;
+		index->capacity *= 2;
+	}
+
+	target = &index->targets[index->numTargets];
+	target->elem = elem;
+	target->script = script;
+	target->x = x;
+	target->y = y;
+	target->kind = kind;
+	target->removed = false;
+
+	linkTarget(index, index->numTargets++);
+
+	return true;
+}
+
+/* Called by layoutScript for every elem */
+static void addTargets(scriptElem_t *elem, scriptElem_t *parent, int24_t x, int24_t top, uint24_t width, uint24_t height, void *data) {
+	dropBuild_t *build = data;
+	dropIndex_t *index = build->index;
+
+	if(!build->ok) return;
+
+	switch(elem->type) {
+		case BLOCK_START:
+		case ON_GREEN_FLAG:
+		case ON_KEY:
+		case ON_CLICK:
+		case ON_CLONE:
+			build->ok = addTarget(index, DROP_BELOW, build->script, elem, x, top + height);
+			break;
+		case BLOCK_RING_START:
+			build->ok = addTarget(index, DROP_RING, build->script, elem, x + RING_PADDING, top + RING_PADDING);
+			break;
+	}
+
+	/* Everything in a predicate other than its text is an input */
+	if(build->ok && parent && parent->type == PREDICATE_START && elem->type != TITLE_TEXT) {
+		build->ok = addTarget(index, DROP_SLOT, build->script, elem, x, top + height / 2);
+	}
+}
+
+bool dropAddScript(dropIndex_t *index, scriptElem_t *script, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache) {
+	dropBuild_t build;
+
+	build.index = index;
+	build.script = script;
+	build.ok = index->targets != NULL;
+	layoutScript(script, x, y, widthCache, heightCache, addTargets, &build);
+
+	if(!build.ok) dbg_sprintf(dbgerr, "Out of memory indexing drop targets of script %p\n", script);
+
+	return build.ok;
+}
+
+void dropRemove(dropIndex_t *index, scriptElem_t *first, scriptElem_t *last, int24_t top, uint24_t height) {
+	scriptElem_t *script = NULL;
+	uint24_t i;
+
+	for(i = 0; i < index->numTargets; i++) {
+		dropTarget_t *target = &index->targets[i];
+		if(target->elem >= first && target->elem <= last) {
+			target->removed = true;
+			script = target->script;
+		}
+	}
+
+	/* Everything below the gap in the same script moves up, which can change its cell */
+	for(i = 0; i < DROP_NUM_BUCKETS; i++) {
+		index->buckets[i] = -1;
+	}
+
+	for(i = 0; i < index->numTargets; i++) {
+		dropTarget_t *target = &index->targets[i];
+
+		if(target->removed) continue;
+		if(target->script == script && target->y >= top + (int24_t)height) target->y -= height;
+
+		linkTarget(index, i);
+	}
+}
+
+bool dropAccepts(uint8_t kind, uint8_t type) {
+	switch(type) {
+		case BLOCK_START:
+			return kind == DROP_BELOW || kind == DROP_RING;
+		case REPORTER_START:
+		case PREDICATE_START:
+			return kind == DROP_SLOT;
+		default:
+			return false;
+	}
+}
+
+dropTarget_t *dropNearest(dropIndex_t *index, int24_t x, int24_t y, uint8_t type, uint24_t range) {
+	dropTarget_t *nearest = NULL;
+	uint24_t nearestDistance = 0;
+	int24_t cellX, cellY;
+
+	/* Only the cells that overlap the range need to be checked */
+	for(cellY = CELL(y - (int24_t)range); cellY <= CELL(y + (int24_t)range); cellY++) {
+		for(cellX = CELL(x - (int24_t)range); cellX <= CELL(x + (int24_t)range); cellX++) {
+			int24_t i;
+
+			/* Buckets are shared by several cells, so this can also find targets in other cells */
+			for(i = index->buckets[BUCKET(cellX, cellY)]; i >= 0; i = index->targets[i].next) {
+				dropTarget_t *target = &index->targets[i];
+				int24_t dx = target->x - x;
+				int24_t dy = target->y - y;
+				uint24_t distance;
+
+				if(!dropAccepts(target->kind, type)) continue;
+				if(dx < -(int24_t)range || dx > (int24_t)range || dy < -(int24_t)range || dy > (int24_t)range) continue;
+
+				distance = dx * dx + dy * dy;
+				if(!nearest || distance < nearestDistance) {
+					nearest = target;
+					nearestDistance = distance;
+				}
+			}
+		}
+	}
+
+	return nearest;
+}
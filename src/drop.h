@@ -0,0 +1,74 @@
+#ifndef H_DROP
+#define H_DROP
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+
+/* Targets are bucketed into grid cells of 1 << DROP_CELL_SHIFT pixels square */
+#define DROP_CELL_SHIFT 5
+/* Number of buckets that grid cells are hashed into, must be a power of two */
+#define DROP_NUM_BUCKETS 64
+/* Number of targets there is room for before the first one is added */
+#define DROP_INITIAL_CAPACITY 32
+
+/* Where a dragged element can be dropped */
+enum DropKinds {
+	DROP_BELOW,	/* The bottom notch of a block or hat, which command blocks attach to */
+	DROP_SLOT,	/* An input of a predicate, which reporters and predicates replace */
+	DROP_RING	/* The inside of a ring, which command blocks go into */
+};
+
+typedef struct DropTarget {
+	scriptElem_t *elem;	/* The block, input or ring being dropped onto */
+	scriptElem_t *script;	/* The first element of the script elem is in */
+	int24_t x;			/* Where the top left of a dropped block would go, or the left of an input */
+	int24_t y;			/* Likewise, but the center of an input */
+	uint8_t kind;
+	bool removed;		/* Part of a detached subtree, and left out of the buckets */
+	int24_t next;		/* Index of the next target in the same bucket, or -1 */
+} dropTarget_t;
+
+/* Every drop target in a set of scripts, bucketed by position */
+typedef struct DropIndex {
+	dropTarget_t *targets;
+	uint24_t numTargets;
+	uint24_t capacity;
+	int24_t buckets[DROP_NUM_BUCKETS];	/* Index of the first target in each bucket, or -1 */
+} dropIndex_t;
+
+/* Returns false if out of memory */
+bool dropInit(dropIndex_t *index);
+void dropFree(dropIndex_t *index);
+
+/* Remove every target */
+void dropClear(dropIndex_t *index);
+
+/* Add the targets in a script drawn with its top left corner at x, y */
+/* widthCache and heightCache are the ones the script is drawn with, and should be non-null */
+/* Returns false if out of memory, in which case only some of the targets are added */
+bool dropAddScript(dropIndex_t *index, scriptElem_t *script, int24_t x, int24_t y, uint24_t *widthCache, uint24_t *heightCache);
+
+/* Remove the targets belonging to the elems from first up to and including last */
+/* Used when a subtree is picked up, so that it can't be dropped onto itself */
+/* top and height are where the subtree was drawn, and the rest of its script below that moves up to close the gap */
+/* Removed targets stay out of the way until the index is cleared */
+void dropRemove(dropIndex_t *index, scriptElem_t *first, scriptElem_t *last, int24_t top, uint24_t height);
+
+/* Whether an element of some type can be dropped onto a kind of target */
+bool dropAccepts(uint8_t kind, uint8_t type);
+
+/* Find the closest target to a point that an element of some type can be dropped onto */
+/* Only targets within range pixels on both axes are considered */
+/* Returns NULL if there aren't any */
+dropTarget_t *dropNearest(dropIndex_t *index, int24_t x, int24_t y, uint8_t type, uint24_t range);
+
+#endif
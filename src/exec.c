@@ -0,0 +1,495 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "exec.h"
+#include "prims.h"
+#include "closure.h"
+#include "gc.h"
+
+execStats_t execStats;
+bool execTailCalls = true;
+uint24_t warpBudget = EXEC_DEFAULT_WARP_BUDGET;
+
+/* When the current frame started, for timing warped code */
+static uint24_t frameStart;
+
+static frame_t *pushFrame(thread_t *thread, uint8_t type, scriptElem_t *owner, scriptElem_t *pc, uint24_t mark) {
+	frame_t *frame;
+
+	if(thread->depth == THREAD_MAX_FRAMES) {
+		dbg_sprintf(dbgerr, "Thread %p is too deep, stopping it\n", thread);
+		thread->depth = 0;
+		return NULL;
+	}
+
+	frame = &thread->frames[thread->depth++];
+	frame->type = type;
+	frame->owner = owner;
+	frame->pc = pc;
+	frame->mark = mark;
+	frame->savedEnv = thread->env;
+	if(type == FRAME_WARP) thread->warpDepth++;
+
+	if(thread->depth > execStats.maxDepth) execStats.maxDepth = thread->depth;
+
+	return frame;
+}
+
+static void popFrame(thread_t *thread) {
+	frame_t *frame = &thread->frames[--thread->depth];
+	thread->env = frame->savedEnv;
+	if(frame->type == FRAME_WARP) thread->warpDepth--;
+	regionRelease(&thread->region, frame->mark);
+}
+
+thread_t *threadNew(scriptElem_t *script, struct Sprite *sprite) {
+	thread_t *thread = malloc(sizeof(thread_t));
+	scriptElem_t *start = script;
+
+	if(!thread) return NULL;
+
+	if(!regionInit(&thread->region, THREAD_REGION_SIZE)) {
+		free(thread);
+		return NULL;
+	}
+
+	thread->env = NULL;
+	thread->sprite = sprite;
+	thread->script = script;
+	thread->depth = 0;
+	thread->warpDepth = 0;
+	thread->result = noneValue();
+
+	/* Hat blocks only decide when the script runs */
+	switch(script->type) {
+		case ON_GREEN_FLAG:
+		case ON_KEY:
+		case ON_CLICK:
+		case ON_CONDITION_START:
+		case ON_MESSAGE:
+		case ON_CLONE:
+			start = getNextSibling(script);
+			break;
+	}
+
+	pushFrame(thread, FRAME_SCRIPT, NULL, start, 0);
+
+	return thread;
+}
+
+void threadFree(thread_t *thread) {
+	regionFree(&thread->region);
+	free(thread);
+}
+
+binding_t *envFind(env_t *env, variable_t *var) {
+	uint8_t i;
+
+	if(!env) return NULL;
+
+	for(i = 0; i < env->count; i++) {
+		if(env->slots[i].var == var) return &env->slots[i];
+	}
+
+	return NULL;
+}
+
+value_t *lookupVariable(env_t *env, variable_t *var) {
+	binding_t *binding = envFind(env, var);
+	if(!binding) return &var->value;
+	if(binding->box) return &binding->box->value;
+	return &binding->value;
+}
+
+void setVariable(thread_t *thread, variable_t *var, value_t val) {
+	binding_t *binding = envFind(thread->env, var);
+
+	val = execKeep(thread, val);
+	var->version++;
+
+	if(!binding) {
+		var->value = val;
+		gcAddVariable(var);
+	} else if(binding->box) {
+		/* Boxes are on the heap, and might already have been scanned */
+		binding->box->value = val;
+		gcWriteBarrier(binding->box);
+	} else {
+		binding->value = val;
+	}
+}
+
+value_t execKeep(thread_t *thread, value_t val) {
+	closure_t *copy;
+
+	if(val.type != VAL_CLOSURE || !regionContains(&thread->region, val.as.closure)) return val;
+
+	copy = closureCopyToHeap(thread, val.as.closure);
+	if(!copy) return noneValue();
+
+	return closureValue(copy);
+}
+
+uint8_t execArgs(thread_t *thread, scriptElem_t *elem, value_t *args) {
+	scriptElem_t *arg = elem + 1;
+	uint8_t argc = 0;
+
+	while(arg->type != END_SCRIPT && argc < EXEC_MAX_ARGS) {
+		/* Break if we are at the end of the block */
+		if(arg->type == BLOCK_END) {
+			if(arg->data == (void*)elem) break;
+			/* This is the end of an arglist */
+			arg++;
+			continue;
+		}
+
+		switch(arg->type) {
+			case TITLE_TEXT:
+				arg++;
+				break;
+			case ARGLIST_START:
+				/* Step inside, so that its contents are passed as separate arguments */
+				arg++;
+				break;
+			default:
+				args[argc++] = execEval(thread, arg);
+				arg = getNextSibling(arg);
+				break;
+		}
+	}
+
+	return argc;
+}
+
+/* Get the nth argument of a block without evaluating it, or NULL if there isn't one */
+static scriptElem_t *argElem(scriptElem_t *elem, uint8_t n) {
+	scriptElem_t *arg = elem + 1;
+
+	while(arg->type != END_SCRIPT) {
+		/* Break if we are at the end of the block */
+		if(arg->type == BLOCK_END && arg->data == (void*)elem) break;
+
+		if(arg->type != TITLE_TEXT && !n--) return arg;
+		arg = getNextSibling(arg);
+	}
+
+	return NULL;
+}
+
+/* Start running the contents of a C slot */
+static frame_t *pushSlot(thread_t *thread, uint8_t type, scriptElem_t *slot, uint24_t mark) {
+	if(!slot || slot->type != C_BLOCK_START) return NULL;
+	return pushFrame(thread, type, slot, slot + 1, mark);
+}
+
+/* Start running the body of a custom block */
+/* Arguments are bound to the parameters, which are upvars in an arglist at the start of the definition */
+static void enterCustom(thread_t *thread, scriptElem_t *def, value_t *args, uint8_t argc, uint24_t mark) {
+	scriptElem_t *body = def + 1;
+	scriptElem_t *param;
+	uint8_t numParams = 0;
+	env_t *env;
+	uint8_t i;
+
+	if(body->type == ARGLIST_START) {
+		for(param = body + 1; param->type == UPVAR; param++) numParams++;
+	}
+
+	env = regionAlloc(&thread->region, sizeof(env_t) + numParams * sizeof(binding_t));
+	if(!env) {
+		thread->depth = 0;
+		return;
+	}
+	env->slots = (binding_t*)(env + 1);
+	env->count = numParams;
+
+	/* Parameters without a matching argument are empty */
+	for(i = 0; i < numParams; i++) {
+		env->slots[i].var = (variable_t*)body[i + 1].data;
+		env->slots[i].value = i < argc ? args[i] : noneValue();
+		env->slots[i].box = NULL;
+	}
+	if(body->type == ARGLIST_START) body = getNextSibling(body);
+
+	if(pushFrame(thread, FRAME_CUSTOM, def, body, mark)) {
+		thread->env = env;
+	}
+}
+
+static void pushCustom(thread_t *thread, scriptElem_t *block, scriptElem_t *def, uint24_t mark) {
+	value_t args[EXEC_MAX_ARGS];
+	uint8_t argc = execArgs(thread, block, args);
+	enterCustom(thread, def, args, argc, mark);
+}
+
+/* Whether a frame has run its last block */
+static bool frameDone(frame_t *frame) {
+	scriptElem_t *pc = frame->pc;
+	return pc->type == END_SCRIPT || (pc->type == BLOCK_END && pc->data == (void*)frame->owner);
+}
+
+/* Find the custom block frame that a call can take the place of, or -1 if there isn't one */
+/* Reporting leaves any loops, but other calls are only in tail position if nothing is left to run */
+static int8_t tailFrame(thread_t *thread, bool reporting) {
+	int8_t i;
+
+	if(!execTailCalls) return -1;
+
+	for(i = thread->depth - 1; i >= 0; i--) {
+		frame_t *frame = &thread->frames[i];
+		if(frame->type == FRAME_CUSTOM) return reporting || frameDone(frame) ? i : -1;
+		if(!reporting && (frame->type != FRAME_SEQUENCE || !frameDone(frame))) return -1;
+	}
+
+	return -1;
+}
+
+/* Replace the frame at index, and everything above it, with a call to a custom block */
+/* This keeps the depth constant for recursion in tail position */
+static void tailCall(thread_t *thread, scriptElem_t *call, uint8_t index) {
+	value_t args[EXEC_MAX_ARGS];
+	uint8_t argc = execArgs(thread, call, args);
+	uint24_t mark = thread->frames[index].mark;
+	uint8_t i;
+
+	/* The arguments have to outlive the caller's environment */
+	for(i = 0; i < argc; i++) {
+		args[i] = execKeep(thread, args[i]);
+	}
+
+	while(thread->depth > index) popFrame(thread);
+	enterCustom(thread, (scriptElem_t*)call->data, args, argc, mark);
+	execStats.tailCalls++;
+}
+
+/* Return from the innermost custom block, or stop the script if there isn't one */
+static void doReport(thread_t *thread, value_t val) {
+	thread->result = val;
+
+	while(thread->depth) {
+		bool custom = thread->frames[thread->depth - 1].type == FRAME_CUSTOM;
+		popFrame(thread);
+		if(custom) return;
+	}
+}
+
+static void execCommand(thread_t *thread, scriptElem_t *block) {
+	uint24_t mark = regionMark(&thread->region);
+	value_t args[EXEC_MAX_ARGS];
+	scriptElem_t *arg;
+	primFunc_t func;
+	frame_t *frame;
+	variable_t *var;
+	int8_t index;
+	uint8_t argc;
+
+	if(block->type != BLOCK_START) return;
+
+	if(!IS_PRIM(block->data)) {
+		index = tailFrame(thread, false);
+		if(index >= 0) {
+			tailCall(thread, block, index);
+			return;
+		}
+
+		/* The region is released when the custom block returns */
+		pushCustom(thread, block, (scriptElem_t*)block->data, mark);
+		return;
+	}
+
+	switch(PRIM_ID(block->data)) {
+		case REPEAT:
+			args[0] = execEval(thread, argElem(block, 0));
+			if(valueToNumber(args[0]) < 1) break;
+			frame = pushSlot(thread, FRAME_REPEAT, argElem(block, 1), mark);
+			if(frame) frame->count = valueToNumber(args[0]);
+			break;
+
+		case FOREVER:
+			pushSlot(thread, FRAME_FOREVER, argElem(block, 0), mark);
+			break;
+
+		case WARP:
+			pushSlot(thread, FRAME_WARP, argElem(block, 0), mark);
+			break;
+
+		case IF:
+			if(valueIsTrue(execEval(thread, argElem(block, 0)))) {
+				pushSlot(thread, FRAME_SEQUENCE, argElem(block, 1), mark);
+			}
+			break;
+
+		case IF_ELSE:
+			if(valueIsTrue(execEval(thread, argElem(block, 0)))) {
+				pushSlot(thread, FRAME_SEQUENCE, argElem(block, 1), mark);
+			} else {
+				pushSlot(thread, FRAME_SEQUENCE, argElem(block, 2), mark);
+			}
+			break;
+
+		case REPORT:
+			/* Reporting the result of a custom reporter can reuse this block's frame */
+			arg = argElem(block, 0);
+			if(arg && (arg->type == REPORTER_START || arg->type == PREDICATE_START) && !IS_PRIM(arg->data)) {
+				index = tailFrame(thread, true);
+				if(index >= 0) {
+					tailCall(thread, arg, index);
+					return;
+				}
+			}
+
+			doReport(thread, execKeep(thread, execEval(thread, arg)));
+			return;
+
+		case SET_VAR:
+		case CHANGE_VAR:
+			/* The first argument is the variable itself, not its value */
+			args[0] = execEval(thread, argElem(block, 1));
+			if(!argElem(block, 0) || argElem(block, 0)->type != VARIABLE) break;
+			var = (variable_t*)argElem(block, 0)->data;
+			if(PRIM_ID(block->data) == CHANGE_VAR) {
+				args[0] = numberValue(valueToNumber(*lookupVariable(thread->env, var)) + valueToNumber(args[0]));
+			}
+			setVariable(thread, var, args[0]);
+			break;
+
+		default:
+			func = primitiveFuncs[PRIM_ID(block->data)];
+			if(!func) break;
+			argc = execArgs(thread, block, args);
+			func(thread, args, argc);
+			break;
+	}
+
+	/* Loops and ifs don't keep anything in the region */
+	regionRelease(&thread->region, mark);
+}
+
+/* Whether to yield at the end of a loop iteration */
+/* Warped code keeps going until the frame has used up its budget */
+/* Timer 1 counts up at 32768 Hz from startup, see main */
+static bool shouldYield(thread_t *thread) {
+	if(!thread->warpDepth) return true;
+
+	if(timer_1_Counter - frameStart < warpBudget) {
+		execStats.warpIterations++;
+		return false;
+	}
+
+	execStats.warpYields++;
+	return true;
+}
+
+/* Run blocks until the frame at depth base is done */
+/* If canYield, also stop at the end of each loop iteration */
+static void run(thread_t *thread, uint8_t base, bool canYield) {
+	while(thread->depth > base) {
+		frame_t *frame = &thread->frames[thread->depth - 1];
+		scriptElem_t *block = frame->pc;
+
+		if(frameDone(frame)) {
+			/* End of the sequence */
+			if(frame->type == FRAME_FOREVER || (frame->type == FRAME_REPEAT && --frame->count)) {
+				frame->pc = frame->owner + 1;
+				if(canYield && shouldYield(thread)) return;
+			} else {
+				if(frame->type == FRAME_CUSTOM) thread->result = noneValue();
+				popFrame(thread);
+			}
+			continue;
+		}
+
+		frame->pc = getNextSibling(block);
+		execCommand(thread, block);
+	}
+}
+
+bool execStep(thread_t *thread, uint24_t start) {
+	frameStart = start;
+	run(thread, 0, true);
+	return thread->depth > 0;
+}
+
+/* Run a custom reporter to completion, without yielding */
+static value_t callReporter(thread_t *thread, scriptElem_t *elem) {
+	uint8_t base = thread->depth;
+
+	pushCustom(thread, elem, (scriptElem_t*)elem->data, regionMark(&thread->region));
+	if(thread->depth <= base) return noneValue();
+
+	run(thread, base, false);
+	return thread->result;
+}
+
+static void markEnv(env_t *env) {
+	uint8_t i;
+	if(!env) return;
+	for(i = 0; i < env->count; i++) {
+		gcMarkBinding(&env->slots[i]);
+	}
+}
+
+void threadMarkRoots(thread_t *thread) {
+	uint8_t i;
+
+	markEnv(thread->env);
+	for(i = 0; i < thread->depth; i++) {
+		markEnv(thread->frames[i].savedEnv);
+	}
+	gcMarkValue(thread->result);
+}
+
+value_t execEval(thread_t *thread, scriptElem_t *elem) {
+	value_t args[EXEC_MAX_ARGS];
+	closure_t *closure;
+	primFunc_t func;
+	uint8_t argc;
+
+	if(!elem) return noneValue();
+
+	switch(elem->type) {
+		case BOOLEAN_LITERAL:
+			/* 2 is an empty slot, which is false */
+			return boolValue((uint24_t)elem->data == 1);
+
+		case STRING_LITERAL:
+			return textValue(elem->data);
+
+		case FLOAT_LITERAL:
+			return numberValue(*(float*)elem->data);
+
+		case VARIABLE:
+			return *lookupVariable(thread->env, (variable_t*)elem->data);
+
+		case REPORTER_START:
+		case PREDICATE_START:
+			if(!IS_PRIM(elem->data)) return callReporter(thread, elem);
+
+			func = primitiveFuncs[PRIM_ID(elem->data)];
+			if(!func) return noneValue();
+
+			argc = execArgs(thread, elem, args);
+			return func(thread, args, argc);
+
+		case BLOCK_RING_START:
+		case REPORTER_RING_START:
+		case HIDDEN_REPORTER_RING_START:
+		case PREDICATE_RING_START:
+		case HIDDEN_PREDICATE_RING_START:
+			closure = closureNew(thread, elem);
+			if(!closure) return noneValue();
+			return closureValue(closure);
+
+		default:
+			return noneValue();
+	}
+}
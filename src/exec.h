@@ -0,0 +1,130 @@
+#ifndef H_EXEC
+#define H_EXEC
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "value.h"
+#include "region.h"
+
+/* Bytes of scratch memory each thread gets for environments and rings */
+#define THREAD_REGION_SIZE 1024
+/* Most C slots and custom blocks a thread can be inside at once */
+#define THREAD_MAX_FRAMES 24
+/* Most arguments a single block can be given */
+#define EXEC_MAX_ARGS 8
+/* Default time warped code runs before yielding anyway, in 32768 Hz timer ticks */
+/* About 50 ms, so that the screen still updates and the ON key is still checked 20 times a second */
+#define EXEC_DEFAULT_WARP_BUDGET 1638
+
+struct Box;
+
+/* A local variable's value */
+typedef struct Binding {
+	variable_t *var;
+	value_t value;
+	struct Box *box;	/* Where the value is instead, once a ring has captured the variable */
+} binding_t;
+
+/* The local variables visible to a piece of code */
+/* Anything not bound here is looked up as a global */
+typedef struct Env {
+	binding_t *slots;
+	uint8_t count;
+} env_t;
+
+enum FrameTypes {
+	FRAME_SCRIPT,	/* The top level of a script */
+	FRAME_SEQUENCE,	/* A C slot that runs once */
+	FRAME_REPEAT,	/* A C slot that runs count times */
+	FRAME_FOREVER,	/* A C slot that runs until the thread is stopped */
+	FRAME_CUSTOM,	/* The body of a custom block */
+	FRAME_WARP		/* A C slot that runs once, with loops inside it not yielding */
+};
+
+/* A sequence of blocks that is being run */
+typedef struct Frame {
+	uint8_t type;
+	scriptElem_t *owner;	/* Elem whose BLOCK_END ends the sequence, or NULL for END_SCRIPT */
+	scriptElem_t *pc;		/* Next block to run */
+	uint24_t count;			/* Iterations left, for FRAME_REPEAT */
+	env_t *savedEnv;		/* Environment to go back to, for FRAME_CUSTOM */
+	uint24_t mark;			/* Region mark to release to when the frame is done */
+} frame_t;
+
+struct Sprite;
+
+/* A green thread running a script */
+typedef struct Thread {
+	region_t region;	/* Holds environments and rings that have not escaped */
+	env_t *env;			/* Environment of the code currently running */
+	struct Sprite *sprite;
+	scriptElem_t *script;
+	frame_t frames[THREAD_MAX_FRAMES];
+	uint8_t depth;		/* Number of frames in use, 0 once the thread is done */
+	uint8_t warpDepth;	/* Number of those frames that are FRAME_WARP */
+	value_t result;		/* Value reported by the last custom reporter */
+} thread_t;
+
+/* Counters for seeing how much tail calls save */
+typedef struct ExecStats {
+	uint24_t tailCalls;	/* Custom block calls that reused their caller's frame */
+	uint8_t maxDepth;	/* Most frames any thread has used */
+	uint24_t warpIterations;	/* Loop iterations that ran on without yielding because of warp */
+	uint24_t warpYields;		/* Times warped code ran out of time and yielded anyway */
+} execStats_t;
+
+extern execStats_t execStats;
+
+/* Time warped code can run for in each frame before it yields, in timer ticks */
+/* This is shared by every thread stepped in the frame, not given to each of them */
+extern uint24_t warpBudget;
+
+/* Whether custom blocks called in tail position replace their caller's frame, on by default */
+/* Self-recursive blocks then run in constant space, like a loop */
+extern bool execTailCalls;
+
+/* Start a thread at the top of a script, below its hat block if it has one */
+/* Returns NULL if out of memory */
+thread_t *threadNew(scriptElem_t *script, struct Sprite *sprite);
+void threadFree(thread_t *thread);
+
+/* Run the thread until it yields at the end of a loop iteration */
+/* frameStart is timer_1_Counter at the start of the frame the step is part of */
+/* Inside warp, loops only yield once warpBudget ticks have passed since then */
+/* Returns false once the thread is done */
+bool execStep(thread_t *thread, uint24_t frameStart);
+
+/* Mark every value the thread can reach, for the garbage collector */
+void threadMarkRoots(thread_t *thread);
+
+/* Evaluate a reporter, predicate, literal, variable or ring */
+/* Rings are left in the thread's region, for the caller to release */
+value_t execEval(thread_t *thread, scriptElem_t *elem);
+
+/* Evaluate every argument of a block, skipping title text */
+/* ARGLIST_START groups are expanded in place, for variadic inputs */
+/* Returns the number of arguments */
+uint8_t execArgs(thread_t *thread, scriptElem_t *elem, value_t *args);
+
+/* Find a local variable, returns NULL if it isn't bound in env */
+binding_t *envFind(env_t *env, variable_t *var);
+
+/* Find where a variable's value is stored, whether local or global */
+value_t *lookupVariable(env_t *env, variable_t *var);
+
+/* Set a variable, whether local or global, keeping the value out of the thread's region */
+void setVariable(thread_t *thread, variable_t *var, value_t val);
+
+/* Move a value that is about to be stored somewhere long-lived out of the thread's region */
+value_t execKeep(thread_t *thread, value_t val);
+
+#endif
@@ -0,0 +1,300 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "gc.h"
+#include "list.h"
+#include "closure.h"
+#include "str.h"
+#include "sched.h"
+
+/* Incremental tri-color mark and sweep */
+/* Objects allocated while marking start black, and stores into black objects turn them gray again */
+/* Roots are marked at the start of a cycle, and again before sweeping */
+
+gcStats_t gcStats;
+uint8_t gcPhase = GC_IDLE;
+uint24_t gcBudget = GC_DEFAULT_BUDGET;
+
+static gcHeader_t *heap;		/* Every object, newest first */
+static gcHeader_t *grayList;	/* Objects waiting to be scanned */
+static gcHeader_t **sweepPos;	/* Link to the next object to be swept */
+static uint8_t currentWhite = GC_WHITE0;
+static uint24_t threshold = GC_MIN_THRESHOLD;
+static bool forceCycle;
+
+static value_t *roots[GC_MAX_ROOTS];
+static uint8_t numRoots;
+static variable_t *rootVariables;
+
+/* The white of objects that were not reached in the last mark */
+#define deadWhite (currentWhite ^ 1)
+
+void *gcAlloc(uint8_t type, size_t size) {
+	gcHeader_t *obj = calloc(1, size);
+	if(!obj) {
+		dbg_sprintf(dbgerr, "Out of memory allocating %u bytes\n", size);
+		return NULL;
+	}
+
+	obj->type = type;
+	obj->size = size;
+	obj->color = gcPhase == GC_MARK ? GC_BLACK : currentWhite;
+	obj->next = heap;
+	heap = obj;
+
+	gcStats.objects++;
+	gcStats.heapUsed += size;
+	if(gcStats.heapUsed > gcStats.heapPeak) gcStats.heapPeak = gcStats.heapUsed;
+
+	return obj;
+}
+
+void gcResize(void *obj, int24_t delta) {
+	((gcHeader_t*)obj)->size += delta;
+	gcStats.heapUsed += delta;
+	if(gcStats.heapUsed > gcStats.heapPeak) gcStats.heapPeak = gcStats.heapUsed;
+}
+
+void gcRescan(void *obj) {
+	gcHeader_t *header = obj;
+	header->color = GC_GRAY;
+	header->gray = grayList;
+	grayList = header;
+}
+
+static void shade(void *obj) {
+	if(obj && ((gcHeader_t*)obj)->color == currentWhite) gcRescan(obj);
+}
+
+static void markClosureSlots(closure_t *closure) {
+	uint8_t i;
+	for(i = 0; i < closure->numSlots; i++) {
+		gcMarkBinding(&closure->slots[i]);
+	}
+}
+
+void gcMarkBinding(const binding_t *binding) {
+	gcMarkValue(binding->value);
+	shade(binding->box);
+}
+
+void gcMarkValue(value_t val) {
+	switch(val.type) {
+		case VAL_LIST:
+			shade(val.as.list);
+			break;
+		case VAL_STRING:
+			shade(val.as.string);
+			break;
+		case VAL_CLOSURE:
+			/* Closures in a thread's region don't get collected, but what they captured might */
+			if(val.as.closure->gc.type == GC_REGION) {
+				markClosureSlots(val.as.closure);
+			} else {
+				shade(val.as.closure);
+			}
+			break;
+	}
+}
+
+/* Mark everything an object refers to */
+static void scan(gcHeader_t *obj) {
+	obj->color = GC_BLACK;
+
+	switch(obj->type) {
+		case GC_LIST: {
+			list_t *list = (list_t*)obj;
+			shade(list->buf);
+			shade(list->rest);
+			break;
+		}
+		case GC_LIST_BUFFER: {
+			listBuffer_t *buf = (listBuffer_t*)obj;
+			uint24_t i;
+			for(i = buf->lo; i < buf->hi; i++) {
+				gcMarkValue(buf->items[i]);
+			}
+			break;
+		}
+		case GC_CLOSURE:
+			markClosureSlots((closure_t*)obj);
+			break;
+		case GC_BOX:
+			gcMarkValue(((box_t*)obj)->value);
+			break;
+		case GC_STRING: {
+			string_t *str = (string_t*)obj;
+			if(str->kind == STR_ROPE) {
+				gcMarkValue(str->as.rope.left);
+				gcMarkValue(str->as.rope.right);
+			}
+			break;
+		}
+	}
+}
+
+static void markRoots(void) {
+	variable_t *var;
+	uint8_t i;
+
+	for(i = 0; i < numRoots; i++) {
+		gcMarkValue(*roots[i]);
+	}
+	for(var = rootVariables; var; var = var->nextRoot) {
+		gcMarkValue(var->value);
+	}
+	schedMarkRoots();
+}
+
+static void scanGray(void) {
+	gcHeader_t *obj = grayList;
+	grayList = obj->gray;
+	scan(obj);
+}
+
+static void freeObject(gcHeader_t *obj) {
+	gcStats.heapUsed -= obj->size;
+	gcStats.objects--;
+	gcStats.freed++;
+
+	if(obj->type == GC_LIST_BUFFER) free(((listBuffer_t*)obj)->items);
+	if(obj->type == GC_STRING && ((string_t*)obj)->kind == STR_FLAT) free(((string_t*)obj)->as.ptr);
+	free(obj);
+}
+
+/* Do a small, fixed amount of work */
+/* Returns false if there was nothing to do */
+static bool gcStep(void) {
+	uint8_t i;
+
+	switch(gcPhase) {
+		case GC_IDLE:
+			if(!forceCycle && gcStats.heapUsed < threshold) return false;
+			forceCycle = false;
+			gcPhase = GC_MARK;
+			markRoots();
+			return true;
+
+		case GC_MARK:
+			for(i = 0; i < GC_WORK_UNIT && grayList; i++) {
+				scanGray();
+			}
+			if(grayList) return true;
+
+			/* Anything stored in a root since the start of the cycle still needs marking */
+			markRoots();
+			while(grayList) scanGray();
+
+			/* Whatever is still white is garbage */
+			currentWhite = deadWhite;
+			sweepPos = &heap;
+			gcPhase = GC_SWEEP;
+			return true;
+
+		case GC_SWEEP:
+			for(i = 0; i < GC_WORK_UNIT && *sweepPos; i++) {
+				gcHeader_t *obj = *sweepPos;
+				if(obj->color == deadWhite) {
+					*sweepPos = obj->next;
+					freeObject(obj);
+				} else {
+					obj->color = currentWhite;
+					sweepPos = &obj->next;
+				}
+			}
+			if(*sweepPos) return true;
+
+			/* Collect again once the heap has grown enough */
+			gcPhase = GC_IDLE;
+			gcStats.cycles++;
+			threshold = gcStats.heapUsed * 2;
+			if(threshold < GC_MIN_THRESHOLD) threshold = GC_MIN_THRESHOLD;
+			if(threshold > GC_HEAP_SIZE * 3 / 4) threshold = GC_HEAP_SIZE * 3 / 4;
+			return true;
+	}
+
+	return false;
+}
+
+/* Timer 1 counts up at 32768 Hz from startup, see main */
+void gcSlice(void) {
+	uint24_t start = timer_1_Counter;
+	uint24_t elapsed;
+
+	if(!gcStep()) return;
+
+	do {
+		elapsed = timer_1_Counter - start;
+	} while(elapsed < gcBudget && gcStep());
+
+	gcStats.lastSlice = elapsed;
+	if(elapsed > gcStats.maxSlice) gcStats.maxSlice = elapsed;
+}
+
+void gcCollect(void) {
+	/* Objects allocated during the current cycle survive it, so finish it first */
+	while(gcPhase != GC_IDLE) gcStep();
+
+	forceCycle = true;
+	gcStep();
+
+	while(gcPhase != GC_IDLE) gcStep();
+}
+
+void gcStartCycle(void) {
+	forceCycle = true;
+}
+
+bool gcAddRoot(value_t *root) {
+	if(numRoots == GC_MAX_ROOTS) return false;
+	roots[numRoots++] = root;
+	return true;
+}
+
+void gcRemoveRoot(value_t *root) {
+	uint8_t i;
+	for(i = 0; i < numRoots; i++) {
+		if(roots[i] == root) {
+			roots[i] = roots[--numRoots];
+			return;
+		}
+	}
+}
+
+void gcAddVariable(variable_t *var) {
+	if(var->rooted) return;
+	var->rooted = true;
+	var->nextRoot = rootVariables;
+	rootVariables = var;
+}
+
+void gcRemoveVariable(variable_t *var) {
+	variable_t **link;
+
+	if(!var->rooted) return;
+
+	for(link = &rootVariables; *link; link = &(*link)->nextRoot) {
+		if(*link == var) {
+			*link = var->nextRoot;
+			break;
+		}
+	}
+
+	var->rooted = false;
+	var->nextRoot = NULL;
+}
+
+void gcPrintStats(void) {
+	dbg_sprintf(dbgout, "heap: %u bytes in %u objects, peak %u\n", gcStats.heapUsed, gcStats.objects, gcStats.heapPeak);
+	dbg_sprintf(dbgout, "slices: last %u ticks, max %u ticks, budget %u\n", gcStats.lastSlice, gcStats.maxSlice, gcBudget);
+	dbg_sprintf(dbgout, "collected: %u objects in %u cycles\n", gcStats.freed, gcStats.cycles);
+}
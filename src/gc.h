@@ -0,0 +1,114 @@
+#ifndef H_GC
+#define H_GC
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "value.h"
+
+/* The heap is roughly 60 KB, so start collecting well before it fills up */
+#define GC_HEAP_SIZE		60000
+#define GC_MIN_THRESHOLD	8192
+/* Objects processed between checks of the timer */
+#define GC_WORK_UNIT		8
+/* Default pause budget per slice, in 32768 Hz timer ticks (about 1 ms) */
+#define GC_DEFAULT_BUDGET	33
+/* Most global values that can be registered as roots */
+#define GC_MAX_ROOTS		32
+
+enum GcTypes {
+	GC_LIST,
+	GC_LIST_BUFFER,
+	GC_CLOSURE,
+	GC_STRING,
+	GC_BOX,
+	GC_REGION,	/* Not on the heap, but may point to things that are */
+	NUM_GC_TYPES
+};
+
+enum GcColors {
+	GC_WHITE0,	/* The two whites swap meanings every cycle */
+	GC_WHITE1,
+	GC_GRAY,	/* Reachable, but contents not scanned yet */
+	GC_BLACK	/* Reachable, and contents scanned */
+};
+
+enum GcPhases {
+	GC_IDLE,
+	GC_MARK,
+	GC_SWEEP
+};
+
+/* Every collected object starts with this */
+typedef struct GcHeader {
+	struct GcHeader *next;	/* Next object on the heap */
+	struct GcHeader *gray;	/* Next object waiting to be scanned */
+	uint24_t size;
+	uint8_t type;
+	uint8_t color;
+} gcHeader_t;
+
+typedef struct GcStats {
+	uint24_t heapUsed;		/* Bytes in live and not yet collected objects */
+	uint24_t heapPeak;
+	uint24_t objects;		/* Number of objects on the heap */
+	uint24_t lastSlice;		/* Ticks taken by the last slice that did any work */
+	uint24_t maxSlice;
+	uint24_t freed;			/* Objects freed since startup */
+	uint24_t cycles;		/* Completed collections */
+} gcStats_t;
+
+extern gcStats_t gcStats;
+extern uint8_t gcPhase;
+/* Pause budget for each slice, in timer ticks */
+extern uint24_t gcBudget;
+
+/* Allocate a zeroed object with a header, returns NULL if out of memory */
+void *gcAlloc(uint8_t type, size_t size);
+
+/* Account for memory an object owns outside of its own allocation */
+void gcResize(void *obj, int24_t delta);
+
+/* Must be called after storing a reference into an object */
+/* If the object was already scanned in this cycle, it will be scanned again */
+#define gcWriteBarrier(obj) do { if(gcPhase == GC_MARK && ((gcHeader_t*)(obj))->color == GC_BLACK) gcRescan(obj); } while(0)
+void gcRescan(void *obj);
+
+/* Mark a value as reachable */
+void gcMarkValue(value_t val);
+
+/* Mark a local variable's value as reachable, wherever it is stored */
+struct Binding;
+void gcMarkBinding(const struct Binding *binding);
+
+/* Register a global value, which is always reachable */
+bool gcAddRoot(value_t *root);
+void gcRemoveRoot(value_t *root);
+
+/* Register a global variable, whose value is then always reachable */
+/* Does nothing if it is already registered */
+/* Scripts register variables as they set them, so this is only needed when storing into one directly */
+void gcAddVariable(variable_t *var);
+/* Must be called before freeing a registered variable */
+void gcRemoveVariable(variable_t *var);
+
+/* Do a slice of collection work, for at most about gcBudget ticks */
+/* Must only be called between thread steps, when every live value is reachable from a root */
+void gcSlice(void);
+
+/* Finish the current cycle and do a complete one, ignoring the budget */
+void gcCollect(void);
+
+/* Start a cycle at the next slice, even if the heap hasn't grown enough to need one */
+void gcStartCycle(void);
+
+void gcPrintStats(void);
+
+#endif
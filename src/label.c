@@ -0,0 +1,153 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+#include <debug.h>
+
+#include "label.h"
+
+/* Text that is drawn a lot is usually a literal, so its address is a good enough key */
+#define LABEL_SLOT(text) ((((uint24_t)(text) >> 4) ^ (uint24_t)(text)) & (LABEL_CACHE_SIZE - 1))
+
+static label_t cache[LABEL_CACHE_SIZE];
+
+label_t *getLabel(const char *text) {
+	label_t *label = &cache[LABEL_SLOT(text)];
+	uint24_t i;
+
+	if(label->offsets && label->text == text) return label;
+
+	/* Replace whatever was in this slot */
+	free(label->offsets);
+	label->text = text;
+	label->length = strlen(text);
+	label->offsets = malloc((label->length + 1) * sizeof(uint24_t));
+	if(!label->offsets) return NULL;
+
+	gfx_SetTextScale(1, 1);
+	label->offsets[0] = 0;
+	for(i = 0; i < label->length; i++) {
+		label->offsets[i + 1] = label->offsets[i] + gfx_GetCharWidth(text[i]);
+	}
+
+	return label;
+}
+
+/* Print glyphs from up to but not including to, which all have to be entirely onscreen */
+static void printRun(label_t *label, uint24_t from, uint24_t to, int24_t x, int24_t y) {
+	char buf[LABEL_RUN_SIZE + 1];
+
+	gfx_SetTextXY(x + label->offsets[from], y);
+
+	/* The text cursor carries on from one piece to the next */
+	while(from < to) {
+		uint24_t length = to - from;
+		if(length > LABEL_RUN_SIZE) length = LABEL_RUN_SIZE;
+
+		memcpy(buf, &label->text[from], length);
+		buf[length] = 0;
+		gfx_PrintString(buf);
+
+		from += length;
+	}
+}
+
+/* Draw glyphs that are partly offscreen one at a time, as clipped sprites */
+static void drawClippedGlyphs(label_t *label, uint24_t from, uint24_t to, int24_t x, int24_t y) {
+	uint8_t transparent;
+
+	if(from >= to) return;
+
+	/* The glyph's background is the text background, which is never drawn */
+	transparent = gfx_SetTransparentColor(LABEL_TRANSPARENT_COLOR);
+
+	for(; from < to; from++) {
+		gfx_TransparentSprite(gfx_GetSpriteChar(label->text[from]), x + label->offsets[from], y);
+	}
+
+	gfx_SetTransparentColor(transparent);
+}
+
+void drawLabel(label_t *label, int24_t x, int24_t y, uint8_t color) {
+	uint24_t *offsets = label->offsets;
+	uint24_t first, last, start, stop;
+
+	/* Nothing to draw */
+	if(!label->length) return;
+	if(y + LABEL_HEIGHT <= 0 || y >= LCD_HEIGHT) return;
+	if(x + (int24_t)labelWidth(label) <= 0 || x >= LCD_WIDTH) return;
+
+	/* Skip glyphs that are entirely off either side of the screen */
+	for(first = 0; x + (int24_t)offsets[first + 1] <= 0; first++);
+	for(last = label->length; x + (int24_t)offsets[last - 1] >= LCD_WIDTH; last--);
+
+	/* Glyphs from start to stop are entirely onscreen */
+	start = first;
+	stop = last;
+	if(y < 0 || y + LABEL_HEIGHT > LCD_HEIGHT) {
+		/* Every glyph is cut off at the top or bottom */
+		start = stop = last;
+	} else {
+		if(x + (int24_t)offsets[first] < 0) start++;
+		if(x + (int24_t)offsets[last] > LCD_WIDTH && stop > start) stop--;
+	}
+
+	gfx_SetTextFGColor(color);
+	gfx_SetTextConfig(gfx_text_noclip);
+
+	printRun(label, start, stop, x, y);
+	drawClippedGlyphs(label, first, start, x, y);
+	drawClippedGlyphs(label, stop, last, x, y);
+}
+
+void drawText(const char *text, int24_t x, int24_t y, uint8_t color) {
+	label_t *label = getLabel(text);
+
+	if(label) {
+		drawLabel(label, x, y, color);
+		return;
+	}
+
+	/* Out of memory, so let graphx do the clipping */
+	gfx_SetTextFGColor(color);
+	gfx_SetTextConfig(gfx_text_clip);
+	gfx_PrintStringXY(text, x, y);
+	gfx_SetTextConfig(gfx_text_noclip);
+}
+
+uint24_t textWidth(const char *text) {
+	label_t *label = getLabel(text);
+
+	if(label) return labelWidth(label);
+
+	gfx_SetTextScale(1, 1);
+	return gfx_GetStringWidth(text);
+}
+
+void labelForget(const char *text) {
+	label_t *label = &cache[LABEL_SLOT(text)];
+
+	if(label->text != text) return;
+
+	free(label->offsets);
+	label->offsets = NULL;
+	label->text = NULL;
+}
+
+void labelFreeCache(void) {
+	uint8_t i;
+
+	for(i = 0; i < LABEL_CACHE_SIZE; i++) {
+		free(cache[i].offsets);
+		cache[i].offsets = NULL;
+		cache[i].text = NULL;
+	}
+}
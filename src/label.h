@@ -0,0 +1,55 @@
+#ifndef H_LABEL
+#define H_LABEL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of labels that are kept measured at once, must be a power of two */
+#define LABEL_CACHE_SIZE 64
+/* Height of every glyph in the font */
+#define LABEL_HEIGHT 8
+/* Most glyphs that are printed as a single string */
+#define LABEL_RUN_SIZE 32
+/* Text background and transparent color, so that only the glyphs themselves are drawn */
+#define LABEL_TRANSPARENT_COLOR 1
+
+/* Where each glyph of a piece of text goes */
+/* Labels are looked up by the address of their text, not its contents */
+typedef struct Label {
+	const char *text;
+	uint24_t length;
+	uint24_t *offsets;	/* x of each glyph from the left of the label, followed by the total width */
+} label_t;
+
+#define labelWidth(label) ((label)->offsets[(label)->length])
+
+/* Get the label for some text, measuring it if it isn't in the cache */
+/* The label is only valid until the next call */
+/* Returns NULL if out of memory */
+label_t *getLabel(const char *text);
+
+/* Draw a label in a color, clipped to the screen */
+/* y refers to the top of the text */
+void drawLabel(label_t *label, int24_t x, int24_t y, uint8_t color);
+
+/* Measure and draw some text in one go */
+void drawText(const char *text, int24_t x, int24_t y, uint8_t color);
+
+/* Width of some text, from its label if possible */
+uint24_t textWidth(const char *text);
+
+/* Forget the label for some text */
+/* This has to be called after text is changed without moving it, or its old measurements will be used */
+void labelForget(const char *text);
+
+/* Free every cached label */
+void labelFreeCache(void);
+
+#endif
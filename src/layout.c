@@ -0,0 +1,84 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "layout.h"
+#include "blockrender.h"
+
+layoutStats_t layoutStats;
+uint24_t layoutBudget = LAYOUT_DEFAULT_BUDGET;
+
+void layoutStart(layoutJob_t *job, scriptElem_t *script, uint24_t *widthCache, uint24_t *heightCache) {
+	job->script = script;
+	job->widthCache = widthCache;
+	job->heightCache = heightCache;
+	job->block = script;
+	job->elem = NULL;
+	job->height = 0;
+}
+
+/* Lay out one elem, returns false if the job is done */
+static bool layoutStep(layoutJob_t *job) {
+	scriptElem_t *block = job->block;
+	scriptElem_t *elem;
+	uint24_t offset;
+
+	if(block->type == END_SCRIPT) return false;
+
+	/* Start from the end of the block */
+	if(!job->elem) job->elem = getNext(block) - 1;
+	elem = job->elem;
+
+	/* BLOCK_ENDs don't have a size */
+	if(elem->type != BLOCK_END) {
+		offset = elem - job->script;
+		getWidth(elem, NULL, job->widthCache + offset);
+		getHeight(elem, NULL, job->heightCache + offset);
+		layoutStats.elems++;
+	}
+
+	if(elem == block) {
+		/* On to the next top level block */
+		job->height += job->heightCache[block - job->script];
+		job->block = getNextSibling(block);
+		job->elem = NULL;
+	} else {
+		job->elem--;
+	}
+
+	return true;
+}
+
+/* Timer 1 counts up at 32768 Hz from startup, see main */
+bool layoutRun(layoutJob_t *job, uint24_t start, uint24_t rows) {
+	uint8_t i;
+
+	while(job->height < rows) {
+		for(i = 0; i < LAYOUT_WORK_UNIT; i++) {
+			if(!layoutStep(job)) return true;
+		}
+
+		if(timer_1_Counter - start >= layoutBudget) return false;
+	}
+
+	return true;
+}
+
+void layoutFinish(layoutJob_t *job) {
+	while(layoutStep(job));
+}
+
+void layoutEndSlice(uint24_t start) {
+	uint24_t elapsed = timer_1_Counter - start;
+
+	layoutStats.lastSlice = elapsed;
+	if(elapsed > layoutStats.maxSlice) layoutStats.maxSlice = elapsed;
+}
@@ -0,0 +1,61 @@
+#ifndef H_LAYOUT
+#define H_LAYOUT
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+
+/* Elems laid out between checks of the timer */
+#define LAYOUT_WORK_UNIT		8
+/* Default time per frame spent on layout, in 32768 Hz timer ticks (about 2 ms) */
+#define LAYOUT_DEFAULT_BUDGET	66
+/* Passed to layoutRun as the number of rows to lay out the whole script */
+#define LAYOUT_ALL_ROWS			0xFFFFFF
+
+/* Filling in a script's width and height caches a bit at a time */
+/* Each top level block is done in turn, starting from its last elem, so that every */
+/* elem's subelements are already cached by the time it is measured */
+typedef struct LayoutJob {
+	scriptElem_t *script;
+	uint24_t *widthCache;
+	uint24_t *heightCache;
+	scriptElem_t *block;	/* Top level block being laid out, or the END_SCRIPT once done */
+	scriptElem_t *elem;		/* Next elem of the block to lay out, or NULL if the block hasn't been started */
+	uint24_t height;		/* Total height of the top level blocks that are done */
+} layoutJob_t;
+
+typedef struct LayoutStats {
+	uint24_t elems;			/* Elems laid out since startup */
+	uint24_t lastSlice;		/* Ticks taken by the last slice that did any work */
+	uint24_t maxSlice;		/* The longest layout has kept input from being checked */
+} layoutStats_t;
+
+extern layoutStats_t layoutStats;
+/* Time spent laying out per slice, in timer ticks */
+extern uint24_t layoutBudget;
+
+/* Start laying out a script into some zeroed caches, the same ones it is drawn with */
+void layoutStart(layoutJob_t *job, scriptElem_t *script, uint24_t *widthCache, uint24_t *heightCache);
+
+#define layoutDone(job) ((job)->block->type == END_SCRIPT)
+
+/* Lay out elems until the top level blocks that are done are at least rows tall, */
+/* or until layoutBudget ticks have passed since start */
+/* Returns false if it ran out of time */
+bool layoutRun(layoutJob_t *job, uint24_t start, uint24_t rows);
+
+/* Lay out everything that's left, ignoring the budget */
+void layoutFinish(layoutJob_t *job);
+
+/* Record how long a slice starting at start took, once all of the slice's jobs have run */
+void layoutEndSlice(uint24_t start);
+
+#endif
@@ -0,0 +1,200 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "list.h"
+
+/* Allocate a buffer, with the free space either before or after the used slots */
+static listBuffer_t *newBuffer(uint24_t capacity, bool freeInFront) {
+	value_t *items = malloc(capacity * sizeof(value_t));
+	listBuffer_t *buf;
+
+	if(!items) return NULL;
+
+	buf = gcAlloc(GC_LIST_BUFFER, sizeof(listBuffer_t));
+	if(!buf) {
+		free(items);
+		return NULL;
+	}
+
+	/* The item storage is freed along with the buffer */
+	gcResize(buf, capacity * sizeof(value_t));
+	buf->items = items;
+	buf->capacity = capacity;
+	buf->lo = buf->hi = freeInFront ? capacity : 0;
+
+	return buf;
+}
+
+static list_t *newHeader(listBuffer_t *buf, uint24_t start, uint24_t count, list_t *rest, uint24_t length) {
+	list_t *list = gcAlloc(GC_LIST, sizeof(list_t));
+	if(!list) return NULL;
+
+	list->buf = buf;
+	list->start = start;
+	list->count = count;
+	list->rest = rest;
+	list->length = length;
+	gcWriteBarrier(list);
+
+	return list;
+}
+
+list_t *listNew(void) {
+	return newHeader(NULL, 0, 0, NULL, 0);
+}
+
+/* Give the list a buffer of its own holding all of its items */
+static bool copyItems(list_t *list, uint24_t capacity) {
+	listBuffer_t *buf = newBuffer(capacity, false);
+	list_t *node;
+	uint24_t copied = 0;
+
+	if(!buf) return false;
+
+	/* Walk the chain of chunks, stopping at our own length in case a tail has grown */
+	for(node = list; node && copied < list->length; node = node->rest) {
+		uint24_t num = node->count;
+		if(num > list->length - copied) num = list->length - copied;
+		memcpy(&buf->items[copied], &node->buf->items[node->start], num * sizeof(value_t));
+		copied += num;
+	}
+
+	buf->hi = copied;
+	gcWriteBarrier(buf);
+	list->buf = buf;
+	list->start = 0;
+	list->count = copied;
+	list->rest = NULL;
+	gcWriteBarrier(list);
+
+	return true;
+}
+
+bool listFlatten(list_t *list) {
+	if(!list->rest) return true;
+
+	#ifdef DBG_LIST
+	dbg_sprintf(dbgout, "flattening list %p of length %u\n", list, list->length);
+	#endif
+
+	/* Leave some room to add items afterwards */
+	return copyItems(list, list->length + LIST_CHUNK_SIZE);
+}
+
+/* Find where an item is stored, flattening the list if it is too far down the chain */
+static value_t *itemSlot(list_t *list, uint24_t index) {
+	list_t *node = list;
+	uint24_t offset = index;
+	uint8_t hops = 0;
+
+	if(index >= list->length) return NULL;
+
+	while(offset >= node->count) {
+		offset -= node->count;
+		node = node->rest;
+
+		/* This list is being used like an array, so make it into one */
+		if(++hops > LIST_MAX_HOPS && listFlatten(list)) {
+			return &list->buf->items[list->start + index];
+		}
+	}
+
+	return &node->buf->items[node->start + offset];
+}
+
+value_t listItem(list_t *list, uint24_t index) {
+	value_t *slot = itemSlot(list, index);
+	if(!slot) return noneValue();
+	return *slot;
+}
+
+bool listReplace(list_t *list, uint24_t index, value_t val) {
+	value_t *slot = itemSlot(list, index);
+	if(!slot) return false;
+	*slot = val;
+
+	/* The slot could be in any buffer in the chain, so we can't tell which one to rescan */
+	if(gcPhase == GC_MARK) gcMarkValue(val);
+
+	return true;
+}
+
+bool listAdd(list_t *list, value_t val) {
+	listBuffer_t *buf;
+
+	/* Only arrayed lists can be added to */
+	if(!listFlatten(list)) return false;
+
+	if(!list->buf) {
+		list->buf = newBuffer(LIST_CHUNK_SIZE, false);
+		if(!list->buf) return false;
+		list->start = 0;
+		gcWriteBarrier(list);
+	} else if(list->start + list->count != list->buf->hi) {
+		/* Another list owns the slot after our last item, so stop sharing */
+		if(!copyItems(list, list->count + LIST_CHUNK_SIZE)) return false;
+	}
+
+	buf = list->buf;
+
+	/* Double the buffer when full, which keeps adding O(1) amortized */
+	if(buf->hi == buf->capacity) {
+		value_t *items = realloc(buf->items, 2 * buf->capacity * sizeof(value_t));
+		if(!items) return false;
+		buf->items = items;
+		gcResize(buf, buf->capacity * sizeof(value_t));
+		buf->capacity *= 2;
+	}
+
+	buf->items[buf->hi++] = val;
+	gcWriteBarrier(buf);
+	list->count++;
+	list->length++;
+
+	return true;
+}
+
+list_t *listInFront(value_t val, list_t *list) {
+	listBuffer_t *buf = list->buf;
+
+	if(buf && list->start == buf->lo && buf->lo > 0) {
+		/* The slot in front of the list is free, so use it */
+		buf->items[--buf->lo] = val;
+		gcWriteBarrier(buf);
+		return newHeader(buf, buf->lo, list->count + 1, list->rest, list->length + 1);
+	}
+
+	/* Start a new chunk, filled from the back so that later items can go in front */
+	buf = newBuffer(LIST_CHUNK_SIZE, true);
+	if(!buf) return NULL;
+	buf->items[--buf->lo] = val;
+	gcWriteBarrier(buf);
+
+	return newHeader(buf, buf->lo, 1, list->length ? list : NULL, list->length + 1);
+}
+
+list_t *listAllButFirst(list_t *list) {
+	list_t *rest = list->rest;
+	list_t *result;
+
+	if(list->length <= 1) return listNew();
+
+	if(list->count > 1) {
+		return newHeader(list->buf, list->start + 1, list->count - 1, rest, list->length - 1);
+	}
+
+	/* The first chunk only holds one item, so the result is the rest of the chain */
+	result = newHeader(rest->buf, rest->start, rest->count, rest->rest, list->length - 1);
+	if(result && result->count > result->length) result->count = result->length;
+
+	return result;
+}
@@ -0,0 +1,72 @@
+#ifndef H_LIST
+#define H_LIST
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "value.h"
+#include "gc.h"
+
+/* Number of items in a freshly allocated buffer */
+#define LIST_CHUNK_SIZE	8
+/* Chunks item access may walk through before the list gets flattened */
+#define LIST_MAX_HOPS	2
+
+/* Item storage, shared between every list that views part of it */
+typedef struct ListBuffer {
+	gcHeader_t gc;
+	value_t *items;
+	uint24_t capacity;
+	uint24_t lo;	/* Lowest slot used by any list */
+	uint24_t hi;	/* One past the highest slot used by any list */
+} listBuffer_t;
+
+/* A list is a run of count items in buf, followed by the items of rest */
+/* Arrayed lists have no rest, so indexing and adding are O(1) */
+/* Linked lists are a chain of chunks, so in front of and all but first are O(1) */
+/* Lengths are fixed when a list is linked in front of, like a snapshot */
+typedef struct List {
+	gcHeader_t gc;
+	listBuffer_t *buf;	/* NULL if the list is empty */
+	uint24_t start;		/* Index of the first item in buf */
+	uint24_t count;		/* Number of items in buf - nonzero unless the list is empty */
+	uint24_t length;	/* Total number of items, including rest */
+	struct List *rest;	/* Remaining items, or NULL if arrayed */
+} list_t;
+
+/* Lists are garbage collected */
+/* Returns NULL if out of memory */
+list_t *listNew(void);
+
+/* Indices are 0-based; Snap's 1-based indices should be converted by the caller */
+/* Returns a VAL_NONE value if the index is out of range */
+value_t listItem(list_t *list, uint24_t index);
+bool listReplace(list_t *list, uint24_t index, value_t val);
+
+/* Append an item, returns false if out of memory */
+bool listAdd(list_t *list, value_t val);
+
+/* Returns a new list with val in front of list, sharing its items */
+list_t *listInFront(value_t val, list_t *list);
+
+/* Returns a new list with every item but the first, sharing its items */
+list_t *listAllButFirst(list_t *list);
+
+/* Copy every item into a single buffer, so that indexing is O(1) */
+/* Returns false if out of memory */
+bool listFlatten(list_t *list);
+
+#define listLength(list) ((list)->length)
+#define listIsLinked(list) ((list)->rest != NULL)
+
+/* Uncomment this to log whenever a list is flattened */
+/* #define DBG_LIST */
+
+#endif
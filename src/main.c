@@ -21,6 +21,10 @@
 
 #include "script.h"
 #include "blockrender.h"
+#include "palette.h"
+#include "label.h"
+#include "bench.h"
+#include "workspace.h"
 
 #include <debug.h>
 
@@ -30,9 +34,8 @@ void test() {
 	int i;
 	#define layers 5
 	scriptElem_t elem[3 + 3 * layers + 15];
-	size_t length;
 	uint24_t width, height;
-	uint24_t *widthCache, *heightCache;
+	workspace_t ws;
 
 	elem[0].type = ON_GREEN_FLAG;
 
@@ -97,18 +100,22 @@ void test() {
 
 	elem[3 + 3 * layers + 14].type = END_SCRIPT;
 
-	/* Allocate memory to be used as a cache so we don't have to recalculate everything */
-	length = getScriptLength(elem);
-	widthCache  = calloc(length, sizeof(uint24_t));
-	heightCache = calloc(length, sizeof(uint24_t));
+	/* The workspace keeps caches for the script so we don't have to recalculate everything */
+	if(!workspaceInit(&ws) || !workspaceAdd(&ws, elem, 20, 20)) {
+		dbg_sprintf(dbgerr, "Out of memory setting up workspace\n");
+		workspaceFree(&ws);
+		return;
+	}
+
+	/* Lay out the script a slice at a time, like a frame loop would */
+	while(!workspaceLayout(&ws));
 
 	/* Draw everything */
 	gfx_FillScreen(BG_COLOR);
-	drawScript(elem, 20, 20, NULL, widthCache, heightCache);
+	workspaceDraw(&ws, NULL);
 	gfx_SwapDraw();
 
-	free(widthCache);
-	free(heightCache);
+	workspaceFree(&ws);
 }
 
 void main(void) {
@@ -116,11 +123,13 @@ void main(void) {
 	dbg_sprintf(dbgout, "Program Started\n");
 	gfx_Begin();
 	gfx_SetDrawBuffer();
-	gfx_SetTextTransparentColor(1);
-	gfx_SetTextBGColor(1);
+	gfx_SetTextTransparentColor(LABEL_TRANSPARENT_COLOR);
+	gfx_SetTextBGColor(LABEL_TRANSPARENT_COLOR);
 	gfx_FillScreen(BG_COLOR);
+	setTheme(THEME_DEFAULT);
 
 	/* Reset the timer */
+	/* It keeps running for the rest of the program, for anything that needs timing */
 	timer_Control = TIMER1_DISABLE;
 	timer_1_Counter = 0;
 	timer_Control = TIMER1_ENABLE | TIMER1_32K | TIMER1_NOINT | TIMER1_UP;
@@ -129,9 +138,12 @@ void main(void) {
 	test();
 
 	/* Print the timer to the console */
-	timer_Control = TIMER1_DISABLE;
 	dbg_sprintf(dbgout, "%u\n", timer_1_Counter);
 
+	#ifdef BENCHMARK
+	runBenchmarks();
+	#endif
+
 	/* Wait for any key */
 	while(!os_GetCSC());
 
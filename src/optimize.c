@@ -0,0 +1,367 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "optimize.h"
+#include "exec.h"
+#include "prims.h"
+#include "str.h"
+
+static bool isFoldable(scriptElem_t *elem);
+
+/* Whether an argument has the same value every time it is evaluated */
+static bool isConstant(scriptElem_t *elem) {
+	switch(elem->type) {
+		case BOOLEAN_LITERAL:
+		case STRING_LITERAL:
+		case FLOAT_LITERAL:
+			return true;
+		case REPORTER_START:
+		case PREDICATE_START:
+			return isFoldable(elem);
+		default:
+			/* Variables can change, and rings capture their environment */
+			return false;
+	}
+}
+
+/* Whether a reporter or predicate can be computed ahead of time */
+static bool isFoldable(scriptElem_t *elem) {
+	scriptElem_t *arg = elem + 1;
+
+	if(!IS_PRIM(elem->data) || !primitiveInfo[PRIM_ID(elem->data)].pure) return false;
+
+	while(!(arg->type == BLOCK_END && arg->data == (void*)elem)) {
+		switch(arg->type) {
+			case TITLE_TEXT:
+			case ARGLIST_START:
+			case BLOCK_END:
+				/* Arglists are checked item by item, like execArgs */
+				arg++;
+				break;
+			default:
+				if(!isConstant(arg)) return false;
+				arg = getNextSibling(arg);
+				break;
+		}
+	}
+
+	return true;
+}
+
+/* Turn a value into a literal elem, with its data in the pool */
+/* Returns false if the value has no literal form, or the pool is full */
+static bool makeLiteral(optScript_t *opt, value_t val, scriptElem_t *dest) {
+	char buf[STR_NUMBER_SIZE];
+	const char *text;
+	float *num;
+
+	switch(val.type) {
+		case VAL_BOOL:
+			dest->type = BOOLEAN_LITERAL;
+			dest->data = (void*)(uint24_t)val.as.boolean;
+			return true;
+
+		case VAL_NUMBER:
+			num = regionAlloc(&opt->pool, sizeof(float));
+			if(!num) return false;
+			*num = val.as.number;
+			dest->type = FLOAT_LITERAL;
+			dest->data = (void*)num;
+			return true;
+
+		case VAL_TEXT:
+		case VAL_STRING:
+			/* Copy even literals, since letters come from a shared buffer */
+			text = valueToText(val, buf);
+			dest->data = regionAlloc(&opt->pool, strlen(text) + 1);
+			if(!dest->data) return false;
+			strcpy(dest->data, text);
+			dest->type = STRING_LITERAL;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/* Number of reporters and predicates in a subtree */
+static uint24_t countReporters(scriptElem_t *elem) {
+	scriptElem_t *end = getNext(elem);
+	uint24_t count = 0;
+
+	for(; elem < end; elem++) {
+		if(elem->type == REPORTER_START || elem->type == PREDICATE_START) count++;
+	}
+
+	return count;
+}
+
+/* Find a custom reporter's parameter, returns -1 if var isn't one */
+static int8_t paramIndex(scriptElem_t *params, variable_t *var) {
+	int8_t i;
+
+	if(!params) return -1;
+
+	for(i = 0; params[i + 1].type == UPVAR; i++) {
+		if(params[i + 1].data == (void*)var) return i;
+	}
+
+	return -1;
+}
+
+/* Get the expression a custom reporter reports, or NULL if it can't be inlined */
+/* The definition has to be a single report block, reporting primitives of literals and parameters */
+/* Since it can't call any custom blocks, it can't be recursive */
+static scriptElem_t *inlineExpr(scriptElem_t *def, scriptElem_t **params) {
+	scriptElem_t *body = def + 1;
+	scriptElem_t *expr, *end, *elem;
+
+	*params = NULL;
+	if(body->type == ARGLIST_START) {
+		*params = body;
+		body = getNextSibling(body);
+	}
+
+	if(body->type != BLOCK_START || body->data != PRIM(REPORT)) return NULL;
+	end = getNextSibling(body);
+	if(end->type != BLOCK_END || end->data != (void*)def) return NULL;
+
+	for(expr = body + 1; expr->type == TITLE_TEXT; expr++);
+	if(expr->type == BLOCK_END) return NULL;
+
+	/* The last elem of the expression, which is its BLOCK_END if it has one */
+	end = getNextSibling(expr) - 1;
+	if(end - expr + 1 > OPT_INLINE_SIZE) return NULL;
+
+	for(elem = expr; elem <= end; elem++) {
+		switch(elem->type) {
+			case REPORTER_START:
+			case PREDICATE_START:
+				if(!IS_PRIM(elem->data)) return NULL;
+				break;
+			case VARIABLE:
+				/* Globals might be shadowed by the caller's locals */
+				if(paramIndex(*params, (variable_t*)elem->data) < 0) return NULL;
+				break;
+			case BOOLEAN_LITERAL:
+			case STRING_LITERAL:
+			case FLOAT_LITERAL:
+			case TITLE_TEXT:
+			case BLOCK_END:
+				break;
+			default:
+				return NULL;
+		}
+	}
+
+	return expr;
+}
+
+/* A script being built up one elem at a time */
+/* Until it is finished, BLOCK_ENDs hold the index of their start rather than a pointer */
+typedef struct ElemBuffer {
+	scriptElem_t *elems;
+	uint24_t length;
+	uint24_t capacity;
+} elemBuffer_t;
+
+static bool emit(elemBuffer_t *out, scriptElem_t *elem) {
+	if(out->length == out->capacity) {
+		scriptElem_t *elems = realloc(out->elems, 2 * out->capacity * sizeof(scriptElem_t));
+		if(!elems) return false;
+		out->elems = elems;
+		out->capacity *= 2;
+	}
+
+	out->elems[out->length++] = *elem;
+	return true;
+}
+
+/* Copy a call's expression into out, with each parameter replaced by its argument */
+/* Returns false if the call can't be inlined, or if out of memory */
+static bool inlineCall(elemBuffer_t *out, scriptElem_t *call) {
+	scriptElem_t *args[EXEC_MAX_ARGS];
+	uint24_t newIndex[OPT_INLINE_SIZE];
+	scriptElem_t *params, *expr, *elem, *end;
+	uint8_t argc = 0;
+	int8_t param;
+
+	if(IS_PRIM(call->data)) return false;
+	expr = inlineExpr((scriptElem_t*)call->data, &params);
+	if(!expr) return false;
+
+	/* Only literals and variables, so that evaluating them more than once or not at all is harmless */
+	for(elem = call + 1; !(elem->type == BLOCK_END && elem->data == (void*)call); elem++) {
+		if(elem->type == TITLE_TEXT) continue;
+		if(elem->type != BOOLEAN_LITERAL && elem->type != STRING_LITERAL &&
+		   elem->type != FLOAT_LITERAL && elem->type != VARIABLE) return false;
+		if(argc == EXEC_MAX_ARGS) return false;
+		args[argc++] = elem;
+	}
+	if(argc != (params ? getLength(params) - 1 : 0)) return false;
+
+	for(elem = expr, end = getNextSibling(expr) - 1; elem <= end; elem++) {
+		scriptElem_t copy = *elem;
+
+		newIndex[elem - expr] = out->length;
+		if(elem->type == VARIABLE) {
+			param = paramIndex(params, (variable_t*)elem->data);
+			copy = *args[param];
+		} else if(elem->type == BLOCK_END) {
+			copy.data = (void*)newIndex[(scriptElem_t*)elem->data - expr];
+		}
+
+		if(!emit(out, &copy)) return false;
+	}
+
+	return true;
+}
+
+/* Copy a script, replacing calls to small custom reporters with their expression */
+/* Returns NULL if nothing could be inlined, or if out of memory */
+static scriptElem_t *inlineCalls(optScript_t *opt, scriptElem_t *script) {
+	size_t length = getScriptLength(script) + 1;
+	uint24_t *newIndex = malloc(length * sizeof(uint24_t));
+	elemBuffer_t out;
+	scriptElem_t *elem;
+	uint24_t i;
+
+	out.length = 0;
+	out.capacity = length;
+	out.elems = malloc(length * sizeof(scriptElem_t));
+	if(!newIndex || !out.elems) goto error;
+
+	for(elem = script;; elem++) {
+		uint24_t start = out.length;
+
+		newIndex[elem - script] = start;
+
+		if(elem->type == REPORTER_START || elem->type == PREDICATE_START) {
+			if(inlineCall(&out, elem)) {
+				opt->inlined++;
+				elem = getNext(elem);
+				continue;
+			}
+			/* Undo anything a failed attempt copied */
+			out.length = start;
+		}
+
+		if(!emit(&out, elem)) goto error;
+		if(elem->type == BLOCK_END) {
+			out.elems[start].data = (void*)newIndex[(scriptElem_t*)elem->data - script];
+		}
+
+		if(elem->type == END_SCRIPT) break;
+	}
+
+	free(newIndex);
+	if(!opt->inlined) {
+		free(out.elems);
+		return NULL;
+	}
+
+	/* Now that the copy won't move, point the ends at their starts */
+	for(i = 0; i < out.length; i++) {
+		if(out.elems[i].type == BLOCK_END) {
+			out.elems[i].data = (void*)&out.elems[(uint24_t)out.elems[i].data];
+		}
+	}
+
+	return out.elems;
+
+	error:
+	free(newIndex);
+	free(out.elems);
+	return NULL;
+}
+
+optScript_t *optimizeScript(scriptElem_t *script) {
+	optScript_t *opt = malloc(sizeof(optScript_t));
+	scriptElem_t *source = NULL;
+	uint24_t *newIndex = NULL;
+	thread_t *thread = NULL;
+	scriptElem_t *elem, *out;
+	size_t length;
+
+	if(!opt) goto error;
+	opt->inlined = 0;
+	opt->folded = 0;
+
+	/* Inlining first gives folding a chance at calls with constant arguments */
+	source = inlineCalls(opt, script);
+	if(!source) source = script;
+
+	length = getScriptLength(source) + 1;
+	newIndex = malloc(length * sizeof(uint24_t));
+	thread = threadNew(source, NULL);
+	if(!newIndex || !thread) goto error;
+
+	/* The copy is never longer than its source */
+	opt->elems = malloc(length * sizeof(scriptElem_t));
+	if(!opt->elems) goto error;
+	if(!regionInit(&opt->pool, length * sizeof(float) + OPT_TEXT_POOL_SIZE)) {
+		free(opt->elems);
+		goto error;
+	}
+
+	for(elem = source, out = opt->elems;; out++) {
+		newIndex[elem - source] = out - opt->elems;
+
+		if((elem->type == REPORTER_START || elem->type == PREDICATE_START) && isFoldable(elem)) {
+			uint24_t mark = regionMark(&thread->region);
+			bool folded = makeLiteral(opt, execEval(thread, elem), out);
+
+			regionRelease(&thread->region, mark);
+
+			if(folded) {
+				opt->folded += countReporters(elem);
+				elem = getNextSibling(elem);
+				continue;
+			}
+		}
+
+		*out = *elem;
+
+		/* Ends point back to their start, which has moved */
+		if(elem->type == BLOCK_END) {
+			out->data = (void*)&opt->elems[newIndex[(scriptElem_t*)elem->data - source]];
+		}
+
+		if(elem->type == END_SCRIPT) break;
+		elem++;
+	}
+
+	#ifdef DBG_OPTIMIZE
+	dbg_sprintf(dbgout, "script %p: inlined %u calls, folded %u reporters, %u elems left\n",
+		script, opt->inlined, opt->folded, out - opt->elems + 1);
+	#endif
+
+	threadFree(thread);
+	free(newIndex);
+	if(source != script) free(source);
+	return opt;
+
+	error:
+	dbg_sprintf(dbgerr, "Out of memory optimizing script %p\n", script);
+	if(thread) threadFree(thread);
+	if(source != script) free(source);
+	free(newIndex);
+	free(opt);
+	return NULL;
+}
+
+void optimizeFree(optScript_t *opt) {
+	if(!opt) return;
+	regionFree(&opt->pool);
+	free(opt->elems);
+	free(opt);
+}
@@ -0,0 +1,42 @@
+#ifndef H_OPTIMIZE
+#define H_OPTIMIZE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "region.h"
+
+/* Largest expression, in elems, that a custom reporter can have and still be inlined */
+#define OPT_INLINE_SIZE 16
+/* Extra bytes in the constant pool for folded text, on top of room for every number */
+#define OPT_TEXT_POOL_SIZE 128
+
+/* A copy of a script prepared for running, with constant reporters precomputed */
+/* The editor keeps drawing and editing the original */
+typedef struct OptScript {
+	scriptElem_t *elems;	/* The optimized copy, ending in END_SCRIPT */
+	region_t pool;			/* Values of folded reporters, pointed to by literals in elems */
+	uint24_t inlined;		/* Number of custom reporter calls replaced with their expression */
+	uint24_t folded;		/* Number of reporters and predicates that were folded away */
+} optScript_t;
+
+/* Make an optimized copy of a script */
+/* Calls to custom reporters that just report a small expression of their inputs are inlined */
+/* Pure reporters and predicates with only constant inputs are replaced with a literal of their value */
+/* Threads running the copy must be stopped before it is freed */
+/* Returns NULL if out of memory */
+optScript_t *optimizeScript(scriptElem_t *script);
+void optimizeFree(optScript_t *opt);
+
+/* Comment this out to stop logging how much each script was folded */
+#define DBG_OPTIMIZE
+
+#endif
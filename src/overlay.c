@@ -0,0 +1,350 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+#include <debug.h>
+
+#include "overlay.h"
+#include "label.h"
+#include "list.h"
+#include "str.h"
+#include "palette.h"
+
+overlayStats_t overlayStats;
+
+void overlayInit(overlaySet_t *set, int24_t originX, int24_t originY) {
+	set->numOverlays = 0;
+	set->originX = originX;
+	set->originY = originY;
+}
+
+/* Forget the labels of a bubble's lines, which are about to be freed or rewritten */
+static void forgetLines(overlay_t *overlay) {
+	char *line = overlay->lines;
+	uint8_t i;
+
+	if(!line) return;
+
+	for(i = 0; i < overlay->numLines; i++) {
+		labelForget(line);
+		line += strlen(line) + 1;
+	}
+}
+
+static void freeLines(overlay_t *overlay) {
+	forgetLines(overlay);
+	free(overlay->lines);
+	overlay->lines = NULL;
+	overlay->numLines = 0;
+}
+
+void overlayFree(overlaySet_t *set) {
+	uint8_t i;
+
+	for(i = 0; i < set->numOverlays; i++) {
+		freeLines(&set->overlays[i]);
+		labelForget(set->overlays[i].value);
+	}
+
+	set->numOverlays = 0;
+}
+
+static overlay_t *addOverlay(overlaySet_t *set, uint8_t kind) {
+	overlay_t *overlay;
+
+	if(set->numOverlays == OVERLAY_MAX) {
+		dbg_sprintf(dbgerr, "Too many overlays\n");
+		return NULL;
+	}
+
+	overlay = &set->overlays[set->numOverlays++];
+	memset(overlay, 0, sizeof(overlay_t));
+	overlay->kind = kind;
+	return overlay;
+}
+
+overlay_t *overlayAddBubble(overlaySet_t *set, sprite_t *sprite) {
+	overlay_t *overlay = addOverlay(set, OVERLAY_BUBBLE);
+
+	if(overlay) overlay->sprite = sprite;
+	return overlay;
+}
+
+overlay_t *overlayAddWatcher(overlaySet_t *set, variable_t *var, int24_t x, int24_t y) {
+	overlay_t *overlay = addOverlay(set, OVERLAY_WATCHER);
+
+	if(!overlay) return NULL;
+
+	overlay->var = var;
+	overlay->x = x;
+	overlay->y = y;
+	return overlay;
+}
+
+void overlayRemove(overlaySet_t *set, overlay_t *overlay, dirtyList_t *dirty) {
+	uint8_t index = overlay - set->overlays;
+	uint8_t i;
+
+	if(overlay->visible) dirtyAdd(dirty, overlay->x, overlay->y, overlay->width, overlay->height);
+	freeLines(overlay);
+
+	/* Watcher values are labeled by their address, which is about to change */
+	for(i = index; i < set->numOverlays; i++) {
+		labelForget(set->overlays[i].value);
+	}
+
+	memmove(overlay, overlay + 1, (set->numOverlays - index - 1) * sizeof(overlay_t));
+	set->numOverlays--;
+}
+
+/* Break text into lines no wider than BUBBLE_MAX_WIDTH, at spaces if possible */
+/* Returns false if out of memory */
+static bool wrapBubble(overlay_t *overlay, const char *text) {
+	const char *lineStart;
+	const char *breakAt;
+	const char *end;
+	uint24_t width;
+	uint24_t breakWidth;
+	uint8_t charWidth;
+	char *dest;
+
+	freeLines(overlay);
+	overlayStats.wraps++;
+
+	/* Each line ends in a null, which either replaces a space or newline or is added mid-word */
+	overlay->lines = malloc(strlen(text) + BUBBLE_MAX_LINES + 1);
+	if(!overlay->lines) return false;
+
+	dest = overlay->lines;
+	overlay->textWidth = 0;
+
+	while(*text && overlay->numLines < BUBBLE_MAX_LINES) {
+		lineStart = text;
+		breakAt = NULL;
+		breakWidth = 0;
+		width = 0;
+
+		/* Take characters until the line is full */
+		while(*text && *text != '\n') {
+			charWidth = gfx_GetCharWidth(*text);
+			if(width + charWidth > BUBBLE_MAX_WIDTH && text != lineStart) break;
+			if(*text == ' ') {
+				breakAt = text;
+				breakWidth = width;
+			}
+			width += charWidth;
+			text++;
+		}
+
+		end = text;
+		if(*text == '\n' || *text == ' ') {
+			/* Full right before a space, or at the end of a line anyway */
+			text++;
+		} else if(*text && breakAt) {
+			/* Move the last word down to the next line */
+			end = breakAt;
+			width = breakWidth;
+			text = breakAt + 1;
+		}
+
+		memcpy(dest, lineStart, end - lineStart);
+		dest += end - lineStart;
+		*dest++ = 0;
+
+		overlay->numLines++;
+		if(width > overlay->textWidth) overlay->textWidth = width;
+	}
+
+	return true;
+}
+
+/* Mark an overlay's box as dirty, and that it has to be drawn */
+static void markChanged(overlay_t *overlay, dirtyList_t *dirty) {
+	dirtyAdd(dirty, overlay->x, overlay->y, overlay->width, overlay->height);
+	overlay->changed = true;
+}
+
+static void updateBubble(overlaySet_t *set, overlay_t *overlay, dirtyList_t *dirty) {
+	sprite_t *sprite = overlay->sprite;
+	bool rewrap;
+	int24_t screenX;
+	int24_t screenY;
+
+	if(!sprite->shown || !sprite->sayText) {
+		if(overlay->visible) dirtyAdd(dirty, overlay->x, overlay->y, overlay->width, overlay->height);
+		overlay->visible = false;
+		return;
+	}
+
+	rewrap = !overlay->lines || sprite->sayVersion != overlay->sayVersion;
+	if(overlay->visible && !rewrap && sprite->x == overlay->spriteX && sprite->y == overlay->spriteY) return;
+
+	/* Clear wherever it was */
+	if(overlay->visible) dirtyAdd(dirty, overlay->x, overlay->y, overlay->width, overlay->height);
+
+	if(rewrap) {
+		overlay->sayVersion = sprite->sayVersion;
+		if(!wrapBubble(overlay, sprite->sayText)) {
+			dbg_sprintf(dbgerr, "Out of memory wrapping speech bubble\n");
+			overlay->visible = false;
+			return;
+		}
+	}
+
+	/* The bubble goes above and to the right of the sprite's position, with the tail pointing to it */
+	screenX = set->originX + sprite->x;
+	screenY = set->originY - sprite->y;
+	overlay->spriteX = sprite->x;
+	overlay->spriteY = sprite->y;
+	overlay->width = BUBBLE_TAIL_WIDTH + overlay->textWidth + 2 * BUBBLE_PADDING;
+	overlay->height = BUBBLE_TAIL_HEIGHT + overlay->numLines * BUBBLE_LINE_HEIGHT
+		- (BUBBLE_LINE_HEIGHT - LABEL_HEIGHT) + 2 * BUBBLE_PADDING;
+	overlay->x = screenX;
+	overlay->y = screenY - overlay->height;
+	overlay->visible = true;
+
+	markChanged(overlay, dirty);
+}
+
+/* Text shown for a value, which is written into buf if it isn't already text */
+static const char *formatValue(value_t val, char *buf) {
+	if(val.type == VAL_LIST) {
+		sprintf(buf, "%u items", listLength(val.as.list));
+		return buf;
+	}
+
+	return valueToText(val, buf);
+}
+
+static void updateWatcher(overlay_t *overlay, dirtyList_t *dirty) {
+	variable_t *var = overlay->var;
+	char buf[STR_NUMBER_SIZE];
+	const char *text;
+
+	/* Lists can change without being set, so they are always checked */
+	if(overlay->visible && var->version == overlay->version && var->value.type != VAL_LIST) return;
+
+	overlay->version = var->version;
+	text = formatValue(var->value, buf);
+
+	/* Setting a variable to what it already was doesn't change anything onscreen */
+	if(overlay->visible && !strncmp(text, overlay->value, WATCHER_VALUE_SIZE - 1)) return;
+
+	labelForget(overlay->value);
+	strncpy(overlay->value, text, WATCHER_VALUE_SIZE - 1);
+	overlay->value[WATCHER_VALUE_SIZE - 1] = 0;
+
+	/* The old box might be wider than the new one */
+	if(overlay->visible) dirtyAdd(dirty, overlay->x, overlay->y, overlay->width, overlay->height);
+
+	overlay->width = textWidth(var->name) + textWidth(overlay->value) + 5 * WATCHER_PADDING;
+	overlay->height = LABEL_HEIGHT + 4 * WATCHER_PADDING;
+	overlay->visible = true;
+
+	markChanged(overlay, dirty);
+}
+
+void overlayUpdate(overlaySet_t *set, dirtyList_t *dirty) {
+	uint8_t i;
+
+	for(i = 0; i < set->numOverlays; i++) {
+		overlay_t *overlay = &set->overlays[i];
+		if(overlay->kind == OVERLAY_BUBBLE) {
+			updateBubble(set, overlay, dirty);
+		} else {
+			updateWatcher(overlay, dirty);
+		}
+	}
+}
+
+static void drawBubble(overlay_t *overlay) {
+	int24_t x = overlay->x + BUBBLE_TAIL_WIDTH;
+	int24_t y = overlay->y;
+	uint24_t width = overlay->width - BUBBLE_TAIL_WIDTH;
+	uint24_t height = overlay->height - BUBBLE_TAIL_HEIGHT;
+	int24_t bottom = y + height - 1;
+	char *line = overlay->lines;
+	uint8_t i;
+
+	gfx_SetColor(gfx_white);
+	gfx_FillRectangle(x + 1, y + 1, width - 2, height - 2);
+	gfx_SetColor(gfx_black);
+	gfx_Rectangle(x, y, width, height);
+
+	if(overlay->sprite->thinking) {
+		/* A trail of circles */
+		gfx_Circle(x, bottom + 3, 2);
+		gfx_Circle(overlay->x + 1, overlay->y + overlay->height - 2, 1);
+	} else {
+		/* A point from the corner of the bubble down to the sprite */
+		gfx_Line(x, bottom - 3, overlay->x, overlay->y + overlay->height - 1);
+		gfx_Line(x + 3, bottom, overlay->x, overlay->y + overlay->height - 1);
+		gfx_SetColor(gfx_white);
+		gfx_HorizLine(x + 1, bottom, 2);
+	}
+
+	x += BUBBLE_PADDING;
+	y += BUBBLE_PADDING;
+	for(i = 0; i < overlay->numLines; i++) {
+		drawText(line, x, y, gfx_black);
+		line += strlen(line) + 1;
+		y += BUBBLE_LINE_HEIGHT;
+	}
+}
+
+static void drawWatcher(overlay_t *overlay) {
+	const blockPalette_t *pal = &palette[VARIABLES];
+	int24_t x = overlay->x;
+	int24_t y = overlay->y;
+	uint24_t nameWidth = textWidth(overlay->var->name);
+	int24_t valueX = x + nameWidth + 2 * WATCHER_PADDING;
+
+	/* Light gray with a darker border */
+	gfx_SetColor(0xDE);
+	gfx_FillRectangle(x + 1, y + 1, overlay->width - 2, overlay->height - 2);
+	gfx_SetColor(0xB5);
+	gfx_Rectangle(x, y, overlay->width, overlay->height);
+	drawText(overlay->var->name, x + WATCHER_PADDING, y + 2 * WATCHER_PADDING, gfx_black);
+
+	/* The value goes in a cell the color of variable blocks */
+	gfx_SetColor(pal->base);
+	gfx_FillRectangle(valueX, y + WATCHER_PADDING, overlay->width - nameWidth - 3 * WATCHER_PADDING, overlay->height - 2 * WATCHER_PADDING);
+	drawText(overlay->value, valueX + WATCHER_PADDING, y + 2 * WATCHER_PADDING, pal->text);
+}
+
+void overlayDraw(overlaySet_t *set, const dirtyList_t *dirty) {
+	uint8_t i;
+
+	for(i = 0; i < set->numOverlays; i++) {
+		overlay_t *overlay = &set->overlays[i];
+
+		if(!overlay->visible) continue;
+
+		/* Anything redrawn underneath it would have drawn over it */
+		if(!overlay->changed && !dirtyIntersects(dirty, overlay->x, overlay->y, overlay->width, overlay->height)) {
+			overlayStats.avoided++;
+			continue;
+		}
+
+		if(overlay->kind == OVERLAY_BUBBLE) {
+			drawBubble(overlay);
+		} else {
+			drawWatcher(overlay);
+		}
+
+		overlay->changed = false;
+		overlayStats.redraws++;
+	}
+}
+
+void overlayPrintStats(void) {
+	dbg_sprintf(dbgout, "overlays: %u redrawn, %u redraws avoided, %u bubbles wrapped\n",
+		overlayStats.redraws, overlayStats.avoided, overlayStats.wraps);
+}
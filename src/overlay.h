@@ -0,0 +1,107 @@
+#ifndef H_OVERLAY
+#define H_OVERLAY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "value.h"
+#include "sprite.h"
+#include "dirty.h"
+
+/* Most overlays on the stage at once */
+#define OVERLAY_MAX				16
+
+/* Widest a line of bubble text gets before it is wrapped */
+#define BUBBLE_MAX_WIDTH		96
+/* Lines past this are left out */
+#define BUBBLE_MAX_LINES		8
+#define BUBBLE_LINE_HEIGHT		10
+/* Space between the text and the edge of the bubble */
+#define BUBBLE_PADDING			3
+/* How far the bubble is from the sprite's position */
+#define BUBBLE_TAIL_WIDTH		8
+#define BUBBLE_TAIL_HEIGHT		8
+
+/* Longest value text shown by a watcher, including the null terminator */
+#define WATCHER_VALUE_SIZE		24
+#define WATCHER_PADDING			2
+
+enum OverlayKinds {
+	OVERLAY_BUBBLE,		/* What a sprite is saying or thinking */
+	OVERLAY_WATCHER		/* The value of a global variable */
+};
+
+/* Something drawn on top of the stage, which is only redrawn when it changes */
+typedef struct Overlay {
+	uint8_t kind;
+	bool visible;		/* Has something to show, so its box is on the screen */
+	bool changed;		/* Has to be drawn this frame, even if nothing under it was redrawn */
+	int24_t x;			/* Box on the screen, as of the last update */
+	int24_t y;
+	uint24_t width;
+	uint24_t height;
+
+	/* Bubbles */
+	sprite_t *sprite;
+	int24_t spriteX;	/* Where the sprite was when the bubble was placed */
+	int24_t spriteY;
+	uint8_t sayVersion;	/* Of the text that was wrapped */
+	char *lines;		/* Wrapped text, each line null terminated, or NULL if not wrapped yet */
+	uint8_t numLines;
+	uint24_t textWidth;	/* Of the widest line */
+
+	/* Watchers */
+	variable_t *var;
+	uint24_t version;	/* Of the value that was formatted */
+	char value[WATCHER_VALUE_SIZE];
+} overlay_t;
+
+typedef struct OverlaySet {
+	overlay_t overlays[OVERLAY_MAX];
+	uint8_t numOverlays;
+	int24_t originX;	/* Screen position of the center of the stage */
+	int24_t originY;
+} overlaySet_t;
+
+typedef struct OverlayStats {
+	uint24_t redraws;	/* Overlays drawn */
+	uint24_t avoided;	/* Overlays that weren't drawn because nothing about them changed */
+	uint24_t wraps;		/* Bubbles whose text had to be wrapped again */
+} overlayStats_t;
+
+extern overlayStats_t overlayStats;
+
+void overlayInit(overlaySet_t *set, int24_t originX, int24_t originY);
+/* Free every overlay's cached layout */
+void overlayFree(overlaySet_t *set);
+
+/* Show a sprite's speech bubble whenever it is saying something */
+/* Returns NULL if there are too many overlays */
+overlay_t *overlayAddBubble(overlaySet_t *set, sprite_t *sprite);
+/* Show a variable's value with its top left corner at x, y on the screen */
+/* Returns NULL if there are too many overlays */
+overlay_t *overlayAddWatcher(overlaySet_t *set, variable_t *var, int24_t x, int24_t y);
+
+/* Take an overlay off the stage, marking where it was as dirty */
+/* Pointers to the set's other overlays may move */
+void overlayRemove(overlaySet_t *set, overlay_t *overlay, dirtyList_t *dirty);
+
+/* Check every overlay for changes since the last frame */
+/* Wherever a changed overlay was, or is now, is marked as dirty */
+/* This has to be called before the stage under the dirty rectangles is redrawn */
+void overlayUpdate(overlaySet_t *set, dirtyList_t *dirty);
+
+/* Draw the overlays that changed, or that anything dirty is under */
+/* This has to be called after the stage under the dirty rectangles is redrawn */
+void overlayDraw(overlaySet_t *set, const dirtyList_t *dirty);
+
+void overlayPrintStats(void);
+
+#endif
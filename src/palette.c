@@ -0,0 +1,87 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+#include <debug.h>
+
+#include "palette.h"
+
+#include "gfx/gfx_group.h"
+
+#define COLOR_LIGHT_ALT 0xD6 // Light color for blocks that are already the alt color
+#define COLOR_GRAY 0xB5
+#define COLOR_TRUE 0x45  // Color used to represent true  in Boolean literals
+#define COLOR_FALSE 0xC9 // Color used to represent false in Boolean literals
+#define COLOR_BOOL_SELECT 0xDE // Color of the circle in the Boolean literal's toggle
+#define COLOR_HAT_EDGE 0xCD // White-ish edge along the top of hat blocks
+
+blockPalette_t palette[NUM_BLOCK_COLORS];
+themeColors_t themeColors;
+
+/* Snap's colors, as stored in the colors sprite */
+static void setDefault(blockColor_t col, blockPalette_t *entry) {
+	/* colors is a 16x4 sprite */
+	entry->base = colors->data[col];
+
+	/* The light color is the alt color with the same hue, except for alt colors which share a generic one */
+	entry->light = col & COLOR_ALT ? COLOR_LIGHT_ALT : colors->data[col | COLOR_ALT];
+	entry->dark = colors->data[col | COLOR_DARK];
+
+	/* Use black text on lighter blocks only */
+	entry->text = col & COLOR_ALT ? gfx_black : gfx_white;
+}
+
+void setTheme(uint8_t theme) {
+	blockColor_t col;
+
+	for(col = 0; col < NUM_BLOCK_COLORS; col++) {
+		blockPalette_t *entry = &palette[col];
+
+		setDefault(col, entry);
+
+		switch(theme) {
+			case THEME_HIGH_CONTRAST:
+				/* Darken the regular colors, so that white text stands out */
+				if(!(col & COLOR_ALT)) entry->base = entry->dark;
+				entry->light = gfx_white;
+				entry->dark = gfx_black;
+				break;
+
+			case THEME_MONOCHROME:
+				entry->base = col & COLOR_ALT ? gfx_white : gfx_black;
+				entry->light = COLOR_GRAY;
+				entry->dark = col & COLOR_ALT ? gfx_black : COLOR_GRAY;
+				break;
+		}
+	}
+
+	themeColors.boolTrue = COLOR_TRUE;
+	themeColors.boolFalse = COLOR_FALSE;
+	themeColors.boolSelect = COLOR_BOOL_SELECT;
+	themeColors.hatEdge = COLOR_HAT_EDGE;
+
+	switch(theme) {
+		case THEME_HIGH_CONTRAST:
+			themeColors.hatEdge = gfx_white;
+			break;
+
+		case THEME_MONOCHROME:
+			themeColors.boolTrue = gfx_white;
+			themeColors.boolFalse = gfx_black;
+			themeColors.boolSelect = COLOR_GRAY;
+			themeColors.hatEdge = COLOR_GRAY;
+			break;
+	}
+
+	#ifdef DBG_DRAW
+	dbg_sprintf(dbgout, "Switched to theme %u\n", theme);
+	#endif
+}
@@ -0,0 +1,50 @@
+#ifndef H_PALETTE
+#define H_PALETTE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blockrender.h"
+
+/* One entry for every possible blockColor_t */
+#define NUM_BLOCK_COLORS 64
+
+/* Every graphx color used to draw a block of a given blockColor_t */
+typedef struct BlockPalette {
+	uint8_t base;	/* Fill */
+	uint8_t light;	/* Top and left edges */
+	uint8_t dark;	/* Bottom and right edges, and empty slots */
+	uint8_t text;	/* Title text */
+} blockPalette_t;
+
+enum Themes {
+	THEME_DEFAULT,			/* Snap's colors, from the colors sprite */
+	THEME_HIGH_CONTRAST,	/* Darker blocks with black and white edges */
+	THEME_MONOCHROME,		/* Black, white and gray only */
+	NUM_THEMES				/* Not an actual theme */
+};
+
+/* Colors that don't depend on a block's color */
+typedef struct ThemeColors {
+	uint8_t boolTrue;	/* Boolean literals that are true */
+	uint8_t boolFalse;	/* Boolean literals that are false */
+	uint8_t boolSelect;	/* The circle in a Boolean literal's toggle */
+	uint8_t hatEdge;	/* Top edge of hat blocks */
+} themeColors_t;
+
+/* Indexed by blockColor_t, so that drawing a block never has to work out a color */
+extern blockPalette_t palette[NUM_BLOCK_COLORS];
+extern themeColors_t themeColors;
+
+/* Fill in the palette for a theme */
+/* This has to be called before anything is drawn, and can be called again at any time to switch themes */
+void setTheme(uint8_t theme);
+
+#endif
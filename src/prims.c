@@ -0,0 +1,251 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "prims.h"
+#include "list.h"
+#include "closure.h"
+#include "sprite.h"
+#include "str.h"
+
+/* Get the argument number i, or nothing if it wasn't given */
+#define ARG(i) ((i) < argc ? args[i] : noneValue())
+#define NUM_ARG(i) valueToNumber(ARG(i))
+#define LIST_ARG(i) ((i) < argc && args[i].type == VAL_LIST ? args[i].as.list : NULL)
+#define RING_ARG(i) ((i) < argc && args[i].type == VAL_CLOSURE ? args[i].as.closure : NULL)
+
+/* Looks */
+
+static value_t primSay(thread_t *thread, value_t *args, uint8_t argc) {
+	sprite_t *sprite = thread->sprite;
+	char buf[STR_NUMBER_SIZE];
+	const char *text;
+
+	if(!sprite) return noneValue();
+
+	if(sprite->sayOwned) free(sprite->sayText);
+	sprite->sayText = NULL;
+	sprite->sayOwned = false;
+	sprite->thinking = false;
+	sprite->sayVersion++;
+
+	if(ARG(0).type == VAL_TEXT) {
+		/* Literals last as long as the script, so they can be shared */
+		sprite->sayText = (char*)ARG(0).as.text;
+	} else if(ARG(0).type != VAL_NONE) {
+		/* Anything else might be collected, so keep a copy */
+		text = valueToText(ARG(0), buf);
+		sprite->sayText = malloc(strlen(text) + 1);
+		if(sprite->sayText) {
+			strcpy(sprite->sayText, text);
+			sprite->sayOwned = true;
+		}
+	}
+
+	return noneValue();
+}
+
+/* Operators */
+
+static value_t primNot(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(!valueIsTrue(ARG(0)));
+}
+
+static value_t primAdd(thread_t *thread, value_t *args, uint8_t argc) {
+	return numberValue(NUM_ARG(0) + NUM_ARG(1));
+}
+
+static value_t primSubtract(thread_t *thread, value_t *args, uint8_t argc) {
+	return numberValue(NUM_ARG(0) - NUM_ARG(1));
+}
+
+static value_t primMultiply(thread_t *thread, value_t *args, uint8_t argc) {
+	return numberValue(NUM_ARG(0) * NUM_ARG(1));
+}
+
+static value_t primDivide(thread_t *thread, value_t *args, uint8_t argc) {
+	return numberValue(NUM_ARG(0) / NUM_ARG(1));
+}
+
+static value_t primLess(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(NUM_ARG(0) < NUM_ARG(1));
+}
+
+static value_t primEquals(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(valueEquals(ARG(0), ARG(1)));
+}
+
+static value_t primGreater(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(NUM_ARG(0) > NUM_ARG(1));
+}
+
+static value_t primAnd(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(valueIsTrue(ARG(0)) && valueIsTrue(ARG(1)));
+}
+
+static value_t primOr(thread_t *thread, value_t *args, uint8_t argc) {
+	return boolValue(valueIsTrue(ARG(0)) || valueIsTrue(ARG(1)));
+}
+
+static value_t primJoin(thread_t *thread, value_t *args, uint8_t argc) {
+	value_t result = textValue("");
+	uint8_t i;
+
+	for(i = 0; i < argc; i++) {
+		result = strJoin(result, args[i]);
+	}
+
+	return result;
+}
+
+static value_t primLetter(thread_t *thread, value_t *args, uint8_t argc) {
+	float index = NUM_ARG(0);
+
+	/* Snap indices start at 1 */
+	if(index < 1) return textValue("");
+	return strLetter(ARG(1), (uint24_t)index - 1);
+}
+
+static value_t primTextLength(thread_t *thread, value_t *args, uint8_t argc) {
+	return numberValue(valueTextLength(ARG(0)));
+}
+
+/* Lists */
+
+static value_t primMakeList(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = listNew();
+	uint8_t i;
+
+	if(!list) return noneValue();
+
+	for(i = 0; i < argc; i++) {
+		listAdd(list, execKeep(thread, args[i]));
+	}
+
+	return listValue(list);
+}
+
+static value_t primNumbers(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = listNew();
+	float from = NUM_ARG(0);
+	float to = NUM_ARG(1);
+	float i;
+
+	if(!list) return noneValue();
+
+	if(from <= to) {
+		for(i = from; i <= to; i++) listAdd(list, numberValue(i));
+	} else {
+		for(i = from; i >= to; i--) listAdd(list, numberValue(i));
+	}
+
+	return listValue(list);
+}
+
+static value_t primItem(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(1);
+	float index = NUM_ARG(0);
+
+	/* Snap indices start at 1 */
+	if(!list || index < 1) return noneValue();
+	return listItem(list, (uint24_t)index - 1);
+}
+
+static value_t primInFront(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(1);
+	if(!list) return noneValue();
+	list = listInFront(execKeep(thread, ARG(0)), list);
+	return list ? listValue(list) : noneValue();
+}
+
+static value_t primAllButFirst(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(0);
+	if(!list) return noneValue();
+	list = listAllButFirst(list);
+	return list ? listValue(list) : noneValue();
+}
+
+static value_t primListLength(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(0);
+	return numberValue(list ? listLength(list) : 0);
+}
+
+static value_t primAddToList(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(1);
+	if(list) listAdd(list, execKeep(thread, ARG(0)));
+	return noneValue();
+}
+
+/* Higher order functions */
+/* The ring is called once per item, with its environment in the thread's region */
+
+static value_t primMap(thread_t *thread, value_t *args, uint8_t argc) {
+	closure_t *ring = RING_ARG(0);
+	list_t *list = LIST_ARG(1);
+	list_t *result;
+	uint24_t i;
+
+	if(!ring || !list) return noneValue();
+
+	result = listNew();
+	if(!result) return noneValue();
+
+	for(i = 0; i < listLength(list); i++) {
+		value_t item = listItem(list, i);
+		listAdd(result, closureCall(thread, ring, &item, 1));
+	}
+
+	return listValue(result);
+}
+
+static value_t primKeep(thread_t *thread, value_t *args, uint8_t argc) {
+	closure_t *ring = RING_ARG(0);
+	list_t *list = LIST_ARG(1);
+	list_t *result;
+	uint24_t i;
+
+	if(!ring || !list) return noneValue();
+
+	result = listNew();
+	if(!result) return noneValue();
+
+	for(i = 0; i < listLength(list); i++) {
+		value_t item = listItem(list, i);
+		if(valueIsTrue(closureCall(thread, ring, &item, 1))) {
+			listAdd(result, item);
+		}
+	}
+
+	return listValue(result);
+}
+
+static value_t primCombine(thread_t *thread, value_t *args, uint8_t argc) {
+	list_t *list = LIST_ARG(0);
+	closure_t *ring = RING_ARG(1);
+	value_t pair[2];
+	uint24_t i;
+
+	if(!ring || !list || !listLength(list)) return noneValue();
+
+	pair[0] = listItem(list, 0);
+	for(i = 1; i < listLength(list); i++) {
+		pair[1] = listItem(list, i);
+		pair[0] = closureCall(thread, ring, pair, 2);
+	}
+
+	return pair[0];
+}
+
+#define PRIMITIVE(id, category, slots, label, pure, func) func,
+const primFunc_t primitiveFuncs[NUM_PRIMATIVES] = {
+	#include "primtable.h"
+};
+#undef PRIMITIVE
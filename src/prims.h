@@ -0,0 +1,25 @@
+#ifndef H_PRIMS
+#define H_PRIMS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "value.h"
+#include "exec.h"
+
+/* Implementation of a primitive block */
+/* args have already been evaluated, and commands report nothing */
+typedef value_t (*primFunc_t)(thread_t *thread, value_t *args, uint8_t argc);
+
+/* Indexed by primitive ID, generated from primtable.h */
+extern const primFunc_t primitiveFuncs[NUM_PRIMATIVES];
+
+#endif
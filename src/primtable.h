@@ -0,0 +1,58 @@
+/* Every primitive block, in order of ID */
+/* This is included wherever something is needed for each primitive, with PRIMITIVE defined to pick out a column */
+/* Adding a primitive only takes a row here, plus its function in prims.c */
+/* Rows may only be added at the end: a primitive's ID is its row, and converted projects store IDs */
+/* Reordering or removing rows needs PROJECT_VERSION in tools/batch/project.h to be bumped */
+
+/* PRIMITIVE(id, category, slots, label, pure, func) */
+/* slots has a character for each input: */
+/*   n - number    s - any    b - boolean    l - list    v - variable */
+/*   r - reporter ring    p - predicate ring    c - C slot    m - multiple inputs */
+/* label has an underscore where each input goes */
+/* pure primitives have no side effects, and always report the same thing given the same inputs */
+/* Lists can be changed after they are made, so nothing that makes or reads one is pure */
+/* func is NULL for control blocks that the executor handles itself */
+
+/* Looks */
+PRIMITIVE(SAY,				LOOKS,		"s",	"say _",					false,	primSay)
+
+/* Operators */
+PRIMITIVE(NOT,				OPERATORS,	"b",	"not _",					true,	primNot)
+PRIMITIVE(ADD,				OPERATORS,	"nn",	"_ + _",					true,	primAdd)
+PRIMITIVE(SUBTRACT,			OPERATORS,	"nn",	"_ - _",					true,	primSubtract)
+PRIMITIVE(MULTIPLY,			OPERATORS,	"nn",	"_ * _",					true,	primMultiply)
+PRIMITIVE(DIVIDE,			OPERATORS,	"nn",	"_ / _",					true,	primDivide)
+PRIMITIVE(LESS,				OPERATORS,	"ss",	"_ < _",					true,	primLess)
+PRIMITIVE(EQUALS,			OPERATORS,	"ss",	"_ = _",					true,	primEquals)
+PRIMITIVE(GREATER,			OPERATORS,	"ss",	"_ > _",					true,	primGreater)
+PRIMITIVE(AND,				OPERATORS,	"bb",	"_ and _",					true,	primAnd)
+PRIMITIVE(OR,				OPERATORS,	"bb",	"_ or _",					true,	primOr)
+
+/* Lists */
+PRIMITIVE(MAKE_LIST,		LISTS,		"m",	"list _",					false,	primMakeList)
+PRIMITIVE(NUMBERS,			LISTS,		"nn",	"numbers from _ to _",		false,	primNumbers)
+PRIMITIVE(ITEM,				LISTS,		"nl",	"item _ of _",				false,	primItem)
+PRIMITIVE(IN_FRONT,			LISTS,		"sl",	"_ in front of _",			false,	primInFront)
+PRIMITIVE(ALL_BUT_FIRST,	LISTS,		"l",	"all but first of _",		false,	primAllButFirst)
+PRIMITIVE(LIST_LENGTH,		LISTS,		"l",	"length of _",				false,	primListLength)
+PRIMITIVE(MAP,				LISTS,		"rl",	"map _ over _",				false,	primMap)
+PRIMITIVE(KEEP,				LISTS,		"pl",	"keep items _ from _",		false,	primKeep)
+PRIMITIVE(COMBINE,			LISTS,		"lr",	"combine _ using _",		false,	primCombine)
+PRIMITIVE(ADD_TO_LIST,		LISTS,		"sl",	"add _ to _",				false,	primAddToList)
+
+/* Variables */
+PRIMITIVE(SET_VAR,			VARIABLES,	"vs",	"set _ to _",				false,	NULL)
+PRIMITIVE(CHANGE_VAR,		VARIABLES,	"vn",	"change _ by _",			false,	NULL)
+
+/* Control */
+PRIMITIVE(REPEAT,			CONTROL,	"nc",	"repeat _ _",				false,	NULL)
+PRIMITIVE(FOREVER,			CONTROL,	"c",	"forever _",				false,	NULL)
+PRIMITIVE(WARP,				CONTROL,	"c",	"warp _",					false,	NULL)
+PRIMITIVE(IF,				CONTROL,	"bc",	"if _ _",					false,	NULL)
+PRIMITIVE(IF_ELSE,			CONTROL,	"bcc",	"if _ _ else _",			false,	NULL)
+PRIMITIVE(REPORT,			CONTROL,	"s",	"report _",					false,	NULL)
+
+/* Text */
+PRIMITIVE(JOIN,				OPERATORS,	"m",	"join _",					true,	primJoin)
+PRIMITIVE(LETTER,			OPERATORS,	"ns",	"letter _ of _",			true,	primLetter)
+PRIMITIVE(TEXT_LENGTH,		OPERATORS,	"s",	"length of text _",			true,	primTextLength)
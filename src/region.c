@@ -0,0 +1,42 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "region.h"
+
+bool regionInit(region_t *region, uint24_t size) {
+	region->base = malloc(size);
+	region->size = region->base ? size : 0;
+	region->used = 0;
+	region->highWater = 0;
+	return region->base != NULL;
+}
+
+void regionFree(region_t *region) {
+	free(region->base);
+	region->base = NULL;
+	region->size = region->used = 0;
+}
+
+void *regionAlloc(region_t *region, uint24_t size) {
+	void *ptr;
+
+	if(region->size - region->used < size) {
+		dbg_sprintf(dbgerr, "Region %p is full\n", region);
+		return NULL;
+	}
+
+	ptr = region->base + region->used;
+	region->used += size;
+	if(region->used > region->highWater) region->highWater = region->used;
+
+	return ptr;
+}
@@ -0,0 +1,34 @@
+#ifndef H_REGION
+#define H_REGION
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A region is a block of memory that is allocated from by bumping a pointer */
+/* Everything allocated after a mark is freed at once by releasing to that mark */
+typedef struct Region {
+	uint8_t *base;
+	uint24_t size;
+	uint24_t used;
+	uint24_t highWater;	/* Most bytes ever in use, for tuning the size */
+} region_t;
+
+/* Returns false if out of memory */
+bool regionInit(region_t *region, uint24_t size);
+void regionFree(region_t *region);
+
+/* Returns NULL if the region is full */
+void *regionAlloc(region_t *region, uint24_t size);
+
+#define regionMark(region) ((region)->used)
+#define regionRelease(region, mark) ((region)->used = (mark))
+#define regionContains(region, ptr) ((uint8_t*)(ptr) >= (region)->base && (uint8_t*)(ptr) < (region)->base + (region)->size)
+
+#endif
@@ -0,0 +1,68 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "sched.h"
+#include "gc.h"
+
+static thread_t *threads[SCHED_MAX_THREADS];
+static uint8_t numThreads;
+
+thread_t *schedStart(scriptElem_t *script, sprite_t *sprite) {
+	thread_t *thread;
+
+	if(numThreads == SCHED_MAX_THREADS) return NULL;
+
+	thread = threadNew(script, sprite);
+	if(thread) threads[numThreads++] = thread;
+
+	return thread;
+}
+
+void schedStopAll(void) {
+	while(numThreads) {
+		threadFree(threads[--numThreads]);
+	}
+}
+
+bool schedStep(void) {
+	uint24_t start = timer_1_Counter;
+	uint8_t i = 0;
+
+	/* Checked between steps, which even warped code gets back to every warpBudget ticks */
+	if(boot_CheckOnPressed()) {
+		schedStopAll();
+		return false;
+	}
+
+	/* Warped threads share one budget, so that the whole frame takes about warpBudget ticks */
+	while(i < numThreads) {
+		if(execStep(threads[i], start)) {
+			i++;
+		} else {
+			/* The thread is done, so replace it with the last one */
+			threadFree(threads[i]);
+			threads[i] = threads[--numThreads];
+		}
+	}
+
+	/* Every value in use is now reachable from a root, so it is safe to collect */
+	gcSlice();
+
+	return numThreads > 0;
+}
+
+void schedMarkRoots(void) {
+	uint8_t i;
+	for(i = 0; i < numThreads; i++) {
+		threadMarkRoots(threads[i]);
+	}
+}
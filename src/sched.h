@@ -0,0 +1,35 @@
+#ifndef H_SCHED
+#define H_SCHED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "exec.h"
+#include "sprite.h"
+
+/* Most scripts that can be running at once */
+#define SCHED_MAX_THREADS 16
+
+/* Start running a script, returns NULL if there are too many threads */
+thread_t *schedStart(scriptElem_t *script, sprite_t *sprite);
+
+/* Stop every thread */
+void schedStopAll(void);
+
+/* Step each thread once, then give the garbage collector a slice */
+/* Holding the ON key stops every thread, like the stop sign */
+/* Returns false if there are no threads left */
+bool schedStep(void);
+
+/* Mark the values every thread can reach, for the garbage collector */
+void schedMarkRoots(void);
+
+#endif
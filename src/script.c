@@ -62,28 +62,102 @@ scriptElem_t *getNext(scriptElem_t *elem) {
 	return elem + getLength(elem);
 }
 
-/* Some temporary primatives for testing purposes */
+scriptElem_t *getNextSibling(scriptElem_t *elem) {
+	scriptElem_t *next = getNext(elem);
+	if(next->type == BLOCK_END && next->data == (void*)elem) next++;
+	return next;
+}
 
-const scriptElem_t prim_Say[] = {
-	{CUSTOM_BLOCK_START, (void*)((1 << 8) + LOOKS)}
-};
+/* Switch each BLOCK_END between pointing to its start and holding its start's index */
+static void endsToIndices(scriptElem_t *elems, size_t length) {
+	size_t i;
 
-const scriptElem_t prim_Not[] = {
-	{CUSTOM_BLOCK_START, (void*)((1 << 8) + OPERATORS)}
-};
+	for(i = 0; i < length; i++) {
+		if(elems[i].type == BLOCK_END) elems[i].data = (void*)((scriptElem_t*)elems[i].data - elems);
+	}
+}
+
+static void endsToPointers(scriptElem_t *elems, size_t length) {
+	size_t i;
+
+	for(i = 0; i < length; i++) {
+		if(elems[i].type == BLOCK_END) elems[i].data = (void*)&elems[(size_t)elems[i].data];
+	}
+}
+
+scriptElem_t *scriptInsert(scriptElem_t *script, size_t index, const scriptElem_t *elems, size_t count) {
+	size_t length = getScriptLength(script) + 1;
+	scriptElem_t *result;
+	size_t i;
+
+	/* Indices stay correct when realloc moves the script */
+	endsToIndices(script, length);
+
+	result = realloc(script, (length + count) * sizeof(scriptElem_t));
+	if(!result) {
+		endsToPointers(script, length);
+		return NULL;
+	}
+
+	/* Starts after the insertion point move along */
+	for(i = 0; i < length; i++) {
+		if(result[i].type == BLOCK_END && (size_t)result[i].data >= index) {
+			result[i].data = (void*)((size_t)result[i].data + count);
+		}
+	}
+
+	memmove(&result[index + count], &result[index], (length - index) * sizeof(scriptElem_t));
+
+	for(i = 0; i < count; i++) {
+		result[index + i] = elems[i];
+		if(elems[i].type == BLOCK_END) result[index + i].data = (void*)((size_t)elems[i].data + index);
+	}
+
+	endsToPointers(result, length + count);
+	return result;
+}
+
+scriptElem_t *scriptDelete(scriptElem_t *script, size_t index, size_t count, scriptElem_t *removed) {
+	size_t length = getScriptLength(script) + 1;
+	scriptElem_t *result;
+	size_t i;
+
+	endsToIndices(script, length);
+
+	if(removed) {
+		for(i = 0; i < count; i++) {
+			removed[i] = script[index + i];
+			if(removed[i].type == BLOCK_END) removed[i].data = (void*)((size_t)removed[i].data - index);
+		}
+	}
+
+	/* Starts after the deleted elems move back */
+	for(i = 0; i < length; i++) {
+		if(script[i].type == BLOCK_END && (size_t)script[i].data >= index + count) {
+			script[i].data = (void*)((size_t)script[i].data - count);
+		}
+	}
+
+	memmove(&script[index], &script[index + count], (length - index - count) * sizeof(scriptElem_t));
+
+	/* Shrinking shouldn't fail, but if it does the script is just bigger than it needs to be */
+	result = realloc(script, (length - count) * sizeof(scriptElem_t));
+	if(!result) result = script;
+
+	endsToPointers(result, length - count);
+	return result;
+}
 
-/* Array of pointers to primative function definitions */
-/* If we just used raw pointers functions would shift around between versions */
-const scriptElem_t *primitiveBlocks[NUM_PRIMATIVES] = {
-	prim_Say,
-	prim_Not
+#define PRIMITIVE(id, category, slots, label, pure, func) {category, sizeof(slots) - 1, slots, label, pure},
+const primInfo_t primitiveInfo[NUM_PRIMATIVES] = {
+	#include "primtable.h"
 };
+#undef PRIMITIVE
 
-/* Get the category of a block */
 uint8_t getCategory(void *data) {
-	if((uint24_t)data >> 16 == 0x80) {
+	if(IS_PRIM(data)) {
 		/* Primitive function */
-		return (uint8_t)primitiveBlocks[(uint24_t)data & 0x00FFFF]->data;
+		return primitiveInfo[PRIM_ID(data)].category;
 	} else {
 		/* User-defined function */
 		return (uint8_t)((scriptElem_t*)data)->data;
@@ -49,11 +49,29 @@ typedef struct ScriptElem {
 /* Returns the next element after the end of elem */
 scriptElem_t *getNext(scriptElem_t *elem);
 
+/* Returns the element after elem, skipping past its BLOCK_END if it has subelements */
+scriptElem_t *getNextSibling(scriptElem_t *elem);
+
 /* Returns the total number of elems in this elem/script */
 /* i.e. 1 for literals, 2 + sum(length of each sub-elem) for blocks */
 size_t getLength(scriptElem_t *elem);
 size_t getScriptLength(scriptElem_t *elem);
 
+/* Detached elems have the index of their start within the detached elems in each BLOCK_END, instead of a pointer */
+/* This lets them be copied and stored anywhere */
+
+/* Insert count detached elems into a script, before the elem at index */
+/* The script is reallocated, so it must have come from malloc, and the old pointer can't be used afterwards */
+/* Returns the new script, or NULL if out of memory, in which case the script is unchanged */
+scriptElem_t *scriptInsert(scriptElem_t *script, size_t index, const scriptElem_t *elems, size_t count);
+
+/* Delete count elems from a script, starting at index */
+/* The elems have to be whole subtrees, so that no BLOCK_END outside of them refers to a start inside them */
+/* If removed is non-null, a detached copy of the deleted elems is written to it */
+/* The script is reallocated, so it must have come from malloc, and the old pointer can't be used afterwards */
+/* Returns the new script */
+scriptElem_t *scriptDelete(scriptElem_t *script, size_t index, size_t count, scriptElem_t *removed);
+
 enum Categories {
 	NO_CATEGORY,
 	MOTION,
@@ -68,18 +86,31 @@ enum Categories {
 	OTHER
 };
 
+/* Get the category of a primitive or custom block */
 uint8_t getCategory(void *data);
 
 /* IDs for primative functions defined in C */
+#define PRIMITIVE(id, category, slots, label, pure, func) id,
 unsigned enum Primitives {
-	SAY,
-	NOT,
+	#include "primtable.h"
 	NUM_PRIMATIVES
 };
+#undef PRIMITIVE
 #define PRIM(p) (void*)(0x800000 + p)
+#define IS_PRIM(data) ((uint24_t)(data) >> 16 == 0x80)
+#define PRIM_ID(data) ((uint24_t)(data) & 0x00FFFF)
+
+/* Everything known about a primitive ahead of time, generated from primtable.h */
+typedef struct PrimInfo {
+	uint8_t category;
+	uint8_t arity;		/* Number of inputs */
+	const char *slots;	/* Type of each input */
+	const char *label;	/* Block text, with an underscore for each input */
+	bool pure;			/* Can be computed ahead of time when the inputs are constant */
+} primInfo_t;
 
-/* Pointers to definitions of primative blocks */
-extern scriptElem_t *primitiveBlocks[NUM_PRIMATIVES];
+/* Indexed by primitive ID */
+extern const primInfo_t primitiveInfo[NUM_PRIMATIVES];
 
 /* Prints information about an element in an easy-to-read format */
 #ifndef NDEBUG
@@ -0,0 +1,254 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+#include <debug.h>
+
+#include "shape.h"
+#include "blockrender.h"
+
+static shape_t cache[SHAPE_CACHE_SIZE];
+static uint24_t useCount;
+
+/* Rasterizing a shape replays the calls that used to draw it, one row at a time */
+/* Each of these only touches the part of row that is in line */
+
+static void rasterHorizLine(uint8_t *line, int24_t row, int24_t x, int24_t y, int24_t length, uint8_t role) {
+	int24_t end = x + length;
+
+	if(y != row) return;
+	if(x < 0) x = 0;
+	if(end > SHAPE_RASTER_WIDTH) end = SHAPE_RASTER_WIDTH;
+	if(end > x) memset(&line[x], role, end - x);
+}
+
+static void rasterVertLine(uint8_t *line, int24_t row, int24_t x, int24_t y, int24_t length, uint8_t role) {
+	if(row >= y && row < y + length) rasterHorizLine(line, row, x, row, 1, role);
+}
+
+static void rasterRectangle(uint8_t *line, int24_t row, int24_t x, int24_t y, int24_t width, int24_t height, uint8_t role) {
+	if(row >= y && row < y + height) rasterHorizLine(line, row, x, row, width, role);
+}
+
+static void rasterPredicate(uint8_t *line, int24_t row, int24_t width, uint24_t height, uint8_t capWidth) {
+	uint24_t halfHeight = height / 2;
+	uint24_t doubleCapWidth = capWidth * 2;
+	uint24_t i;
+
+	/* The caps get taller towards the middle */
+	for(i = 0; i < capWidth; i++) {
+		uint24_t halfSliceHeight = ((i * 2 + 1) * halfHeight + capWidth) / doubleCapWidth;
+		uint24_t sliceHeight = halfSliceHeight * 2 + (height & 1);
+		int24_t sliceY = halfHeight - halfSliceHeight;
+		rasterVertLine(line, row, i, sliceY, sliceHeight, ROLE_BASE);
+		rasterVertLine(line, row, width - 1 - i, sliceY, sliceHeight, ROLE_BASE);
+	}
+
+	rasterRectangle(line, row, capWidth, 0, width - 2 * capWidth, height, ROLE_BASE);
+}
+
+static void rasterReporter(uint8_t *line, int24_t row, int24_t width, uint24_t height) {
+	uint24_t i;
+
+	for(i = 0; i < 3; i++) {
+		rasterHorizLine(line, row, 3 - i, i, width - 6 + 2 * i, ROLE_BASE);
+		rasterHorizLine(line, row, 3 - i, height - i - 1, width - 6 + 2 * i, ROLE_BASE);
+	}
+
+	rasterRectangle(line, row, 0, 3, width, height - 6, ROLE_BASE);
+}
+
+static void rasterBlock(uint8_t *line, int24_t row, int24_t width, uint24_t height) {
+	int24_t i;
+
+	/* Edges */
+	rasterHorizLine(line, row, 1, 0, width - 2, ROLE_LIGHT);
+	rasterVertLine(line, row, 0, 1, height - 2, ROLE_LIGHT);
+	rasterHorizLine(line, row, 1, height - 1, NOTCH_OFFSET - 1, ROLE_DARK);
+	rasterHorizLine(line, row, NOTCH_OFFSET + NOTCH_SIZE, height - 1, width - 1 - (NOTCH_OFFSET + NOTCH_SIZE), ROLE_DARK);
+	rasterVertLine(line, row, width - 1, 1, height - 2, ROLE_DARK);
+
+	/* Inside */
+	rasterRectangle(line, row, 1, 1, width - 2, height - 2, ROLE_BASE);
+	rasterHorizLine(line, row, NOTCH_OFFSET, height - 1, NOTCH_SIZE, ROLE_BASE);
+
+	/* The inverted notch shows the background */
+	rasterRectangle(line, row, NOTCH_OFFSET, 0, NOTCH_SIZE, NOTCH_DEPTH, ROLE_NONE);
+
+	for(i = 0; i < NOTCH_DEPTH; i++) {
+		/* Corners of the inverted notch */
+		rasterHorizLine(line, row, NOTCH_OFFSET + 1, i, i - 1, ROLE_BASE);
+		rasterHorizLine(line, row, NOTCH_OFFSET + NOTCH_SIZE - i, i, i, ROLE_BASE);
+
+		/* The regular notch */
+		rasterHorizLine(line, row, NOTCH_OFFSET + i, height + i, NOTCH_SIZE - 2 * i - 1, i == NOTCH_DEPTH - 1 ? ROLE_DARK : ROLE_BASE);
+
+		rasterHorizLine(line, row, NOTCH_OFFSET + i - 1, i, 1, ROLE_LIGHT);
+		rasterHorizLine(line, row, NOTCH_OFFSET + NOTCH_SIZE - 1 - i, height + i, 1, ROLE_DARK);
+	}
+}
+
+/* Narrowest width at which nothing on the left of a shape overlaps anything on the right */
+static uint24_t minStretchWidth(uint8_t kind, uint8_t capWidth) {
+	switch(kind) {
+		case SHAPE_PREDICATE:
+			return 2 * capWidth;
+		case SHAPE_REPORTER:
+			return 6;
+		default:
+			/* The inverted notch and its corners are drawn over the right edge */
+			return NOTCH_OFFSET + NOTCH_SIZE + 1;
+	}
+}
+
+/* Turn each row into runs of the same color, merging identical rows */
+/* If width is 0, the shape is rasterized to be stretched to any width, otherwise it's drawn as is */
+/* If spans is NULL, the runs are just counted */
+static uint24_t makeSpans(uint8_t kind, uint24_t width, uint24_t height, uint8_t capWidth, span_t *spans) {
+	uint8_t line[SHAPE_RASTER_WIDTH];
+	uint8_t lastLine[SHAPE_RASTER_WIDTH];
+	uint24_t numSpans = 0;
+	uint24_t lastRowStart = 0;
+	uint24_t rows = kind == SHAPE_BLOCK ? height + NOTCH_DEPTH : height;
+	uint24_t row;
+	bool stretch = !width;
+
+	if(stretch) width = SHAPE_RASTER_WIDTH;
+
+	for(row = 0; row < rows; row++) {
+		int24_t start, end;
+
+		memset(line, ROLE_NONE, sizeof(line));
+
+		switch(kind) {
+			case SHAPE_PREDICATE:
+				rasterPredicate(line, row, width, height, capWidth);
+				break;
+			case SHAPE_REPORTER:
+				rasterReporter(line, row, width, height);
+				break;
+			case SHAPE_BLOCK:
+				rasterBlock(line, row, width, height);
+				break;
+		}
+
+		/* The middle of most shapes is the same row over and over */
+		if(row && !memcmp(line, lastLine, sizeof(line))) {
+			uint24_t i;
+			if(spans) {
+				for(i = lastRowStart; i < numSpans; i++) spans[i].rows++;
+			}
+			continue;
+		}
+
+		memcpy(lastLine, line, sizeof(line));
+		lastRowStart = numSpans;
+
+		for(start = 0; start < SHAPE_RASTER_WIDTH; start = end) {
+			for(end = start + 1; end < SHAPE_RASTER_WIDTH && line[end] == line[start]; end++);
+			if(line[start] == ROLE_NONE) continue;
+
+			if(spans) {
+				span_t *span = &spans[numSpans];
+				span->row = row;
+				span->rows = 1;
+				span->role = line[start];
+				span->start = start;
+				span->end = end;
+
+				/* Anything past the middle is measured from the right, so that it moves with the width */
+				if(stretch) {
+					if(start >= SHAPE_RASTER_WIDTH / 2) span->start -= SHAPE_RASTER_WIDTH;
+					if(end > SHAPE_RASTER_WIDTH / 2) span->end -= SHAPE_RASTER_WIDTH;
+				}
+			}
+			numSpans++;
+		}
+	}
+
+	return numSpans;
+}
+
+shape_t *getShape(uint8_t kind, uint24_t width, uint24_t height, uint8_t capWidth) {
+	shape_t *shape = &cache[0];
+	uint8_t i;
+
+	useCount++;
+
+	/* Wide enough shapes all share the same spans */
+	if(width >= minStretchWidth(kind, capWidth)) width = 0;
+
+	for(i = 0; i < SHAPE_CACHE_SIZE; i++) {
+		shape_t *entry = &cache[i];
+
+		if(entry->spans && entry->kind == kind && entry->width == width && entry->height == height && entry->capWidth == capWidth) {
+			entry->lastUsed = useCount;
+			return entry;
+		}
+
+		/* Replace the least recently used shape, or an empty slot */
+		if(!entry->spans || (shape->spans && entry->lastUsed < shape->lastUsed)) shape = entry;
+	}
+
+	free(shape->spans);
+	shape->kind = kind;
+	shape->width = width;
+	shape->height = height;
+	shape->capWidth = capWidth;
+	shape->lastUsed = useCount;
+	shape->numSpans = makeSpans(kind, width, height, capWidth, NULL);
+	shape->spans = malloc(shape->numSpans * sizeof(span_t));
+	if(!shape->spans) return NULL;
+	makeSpans(kind, width, height, capWidth, shape->spans);
+
+	#ifdef DBG_DRAW
+	dbg_sprintf(dbgout, "rasterized shape %u of width %u height %u: %u spans\n", kind, width, height, shape->numSpans);
+	#endif
+
+	return shape;
+}
+
+void drawShape(shape_t *shape, int24_t x, int24_t y, uint24_t width, const blockPalette_t *pal) {
+	uint8_t colors[4];
+	span_t *span = shape->spans;
+	span_t *end = span + shape->numSpans;
+
+	colors[ROLE_NONE] = 0;
+	colors[ROLE_BASE] = pal->base;
+	colors[ROLE_LIGHT] = pal->light;
+	colors[ROLE_DARK] = pal->dark;
+
+	for(; span < end; span++) {
+		int24_t row = y + span->row;
+		int24_t lastRow = row + span->rows;
+		int24_t start = span->start >= 0 ? x + span->start : x + (int24_t)width + span->start;
+		int24_t stop = span->end > 0 ? x + span->end : x + (int24_t)width + span->end;
+
+		if(row < 0) row = 0;
+		if(lastRow > LCD_HEIGHT) lastRow = LCD_HEIGHT;
+		if(start < 0) start = 0;
+		if(stop > LCD_WIDTH) stop = LCD_WIDTH;
+		if(stop <= start) continue;
+
+		for(; row < lastRow; row++) {
+			memset(&gfx_vbuffer[row][start], colors[span->role], stop - start);
+		}
+	}
+}
+
+void shapeFreeCache(void) {
+	uint8_t i;
+
+	for(i = 0; i < SHAPE_CACHE_SIZE; i++) {
+		free(cache[i].spans);
+		cache[i].spans = NULL;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef H_SHAPE
+#define H_SHAPE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "palette.h"
+
+/* Number of shapes that are kept rasterized at once */
+#define SHAPE_CACHE_SIZE 16
+/* Width shapes are rasterized at before being split into left and right parts */
+/* Every corner, cap and notch has to be within half of this of its edge */
+/* Shapes too narrow for their left and right parts to be kept apart are rasterized at their own width */
+#define SHAPE_RASTER_WIDTH 64
+
+enum ShapeKinds {
+	SHAPE_PREDICATE,	/* Hexagon, with caps capWidth wide */
+	SHAPE_REPORTER,		/* Rectangle with rounded corners */
+	SHAPE_BLOCK,		/* Command block, with an edge, a notch in the top and one below */
+	NUM_SHAPE_KINDS		/* Not an actual shape */
+};
+
+/* Which palette color a span is filled with */
+enum ShapeRoles {
+	ROLE_NONE,	/* Left as the background */
+	ROLE_BASE,
+	ROLE_LIGHT,
+	ROLE_DARK
+};
+
+/* A run of pixels the same color, repeated over one or more rows */
+/* start is from the left edge if >= 0, otherwise from the right edge */
+/* end is from the left edge if > 0, otherwise from the right edge, and is exclusive */
+/* This lets one span list be drawn at any width, and any height only adds to rows */
+typedef struct Span {
+	uint24_t row;	/* From the top of the shape */
+	uint24_t rows;
+	uint8_t role;
+	int8_t start;
+	int8_t end;
+} span_t;
+
+/* Every span in a shape of a given kind and size */
+typedef struct Shape {
+	uint8_t kind;
+	uint24_t height;
+	uint8_t capWidth;	/* Only used by SHAPE_PREDICATE */
+	uint24_t width;		/* 0 if the spans can be drawn at any width */
+	uint24_t lastUsed;
+	uint24_t numSpans;	/* Sorted by row */
+	span_t *spans;
+} shape_t;
+
+/* Get the spans for a shape, rasterizing it if it isn't in the cache */
+/* width is only used to tell whether the shape is too narrow to share spans */
+/* The shape is only valid until the next call */
+/* Returns NULL if out of memory */
+shape_t *getShape(uint8_t kind, uint24_t width, uint24_t height, uint8_t capWidth);
+
+/* Fill a shape into the draw buffer, clipped to the screen */
+/* y refers to the top of the shape */
+void drawShape(shape_t *shape, int24_t x, int24_t y, uint24_t width, const blockPalette_t *pal);
+
+/* Free every cached shape */
+void shapeFreeCache(void);
+
+#endif
@@ -13,6 +13,8 @@
 
 #include <graphx.h>
 
+#include "costume.h"
+
 /* Various sprite fields */
 typedef struct Sprite {
 	int24_t x;
@@ -22,11 +24,16 @@ typedef struct Sprite {
 	bool shown;
 	uint8_t currentCostume;
 	uint8_t numCostumes;
-	gfx_sprite_t *costumes;
+	costume_t *costumes;	/* Decompressed as they are needed, see getCostume */
 	bool penDown;
 	uint24_t penHue;
 	char *sayText;
+	bool sayOwned;	/* sayText was allocated for this sprite, rather than being a literal */
+	uint8_t sayVersion;	/* Changed whenever sayText is, since a new text can reuse an old one's address */
 	bool thinking;
 } sprite_t;
 
+/* The costume a sprite is wearing, or NULL if out of memory */
+#define spriteCostume(sprite) getCostume(&(sprite)->costumes[(sprite)->currentCostume])
+
 #endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "str.h"
+
+/* Single letters, each followed by a null, so that letter i of doesn't allocate */
+static char letters[128 * 2];
+
+static string_t *newString(uint8_t kind, uint24_t length) {
+	string_t *str = gcAlloc(GC_STRING, sizeof(string_t));
+	if(!str) return NULL;
+	str->kind = kind;
+	str->length = length;
+	return str;
+}
+
+/* Make a string holding a copy of some text */
+static string_t *copyString(const char *text, uint24_t length) {
+	string_t *str;
+	char *chars;
+
+	if(length <= STR_INLINE_SIZE) {
+		str = newString(STR_SHORT, length);
+		if(!str) return NULL;
+		chars = str->as.chars;
+	} else {
+		chars = malloc(length + 1);
+		if(!chars) return NULL;
+		str = newString(STR_FLAT, length);
+		if(!str) {
+			free(chars);
+			return NULL;
+		}
+		gcResize(str, length + 1);
+		str->as.ptr = chars;
+	}
+
+	memcpy(chars, text, length);
+	chars[length] = 0;
+
+	return str;
+}
+
+/* Larger numbers don't fit in an int24_t */
+#define WHOLE_NUMBER_LIMIT 8388608.0f
+
+static void formatNumber(float num, char *buf) {
+	/* Whole numbers don't get a decimal point */
+	if(fabsf(num) < WHOLE_NUMBER_LIMIT && num == (float)(int24_t)num) {
+		sprintf(buf, "%d", (int)num);
+		return;
+	}
+
+	/* Everything else uses as many digits as a float has, without trailing zeros */
+	/* The longest this can be is -1.234567e-38, which fits */
+	snprintf(buf, STR_NUMBER_SIZE, "%.7g", num);
+}
+
+const char *valueToText(value_t val, char *buf) {
+	switch(val.type) {
+		case VAL_TEXT:
+			return val.as.text;
+
+		case VAL_STRING: {
+			string_t *str = val.as.string;
+			if(!strFlatten(str)) return "";
+			return str->kind == STR_SHORT ? str->as.chars : str->as.ptr;
+		}
+
+		case VAL_NUMBER:
+			formatNumber(val.as.number, buf);
+			return buf;
+
+		case VAL_BOOL:
+			return val.as.boolean ? "true" : "false";
+
+		default:
+			return "";
+	}
+}
+
+uint24_t valueTextLength(value_t val) {
+	char buf[STR_NUMBER_SIZE];
+	if(val.type == VAL_STRING) return val.as.string->length;
+	return strlen(valueToText(val, buf));
+}
+
+static void copyRope(char *dest, string_t *rope);
+
+/* Copy the text of a literal or string, without a null terminator */
+static void copyText(char *dest, value_t val) {
+	string_t *str = val.as.string;
+
+	if(val.type == VAL_TEXT) {
+		memcpy(dest, val.as.text, strlen(val.as.text));
+	} else if(str->kind == STR_SHORT) {
+		memcpy(dest, str->as.chars, str->length);
+	} else if(str->kind == STR_FLAT) {
+		memcpy(dest, str->as.ptr, str->length);
+	} else {
+		copyRope(dest, str);
+	}
+}
+
+/* Walk down the left side of the rope, filling in the text from the end */
+/* Only ropes on the right are recursed into, and those are limited to STR_MAX_DEPTH */
+static void copyRope(char *dest, string_t *rope) {
+	char *end = dest + rope->length;
+	value_t node = stringValue(rope);
+
+	while(node.type == VAL_STRING && node.as.string->kind == STR_ROPE) {
+		string_t *str = node.as.string;
+		value_t right = str->as.rope.right;
+
+		end -= right.type == VAL_STRING ? right.as.string->length : strlen(right.as.text);
+		copyText(end, right);
+		node = str->as.rope.left;
+	}
+
+	copyText(dest, node);
+}
+
+bool strFlatten(string_t *str) {
+	char *chars;
+
+	if(str->kind != STR_ROPE) return true;
+
+	chars = malloc(str->length + 1);
+	if(!chars) return false;
+
+	copyRope(chars, str);
+	chars[str->length] = 0;
+
+	/* The parts of the rope are no longer needed, and will be collected */
+	str->kind = STR_FLAT;
+	str->depth = 0;
+	str->as.ptr = chars;
+	gcResize(str, str->length + 1);
+
+	return true;
+}
+
+#define ropeDepth(val) ((val).type == VAL_STRING && (val).as.string->kind == STR_ROPE ? (val).as.string->depth : 0)
+
+value_t strJoin(value_t a, value_t b) {
+	char bufA[STR_NUMBER_SIZE], bufB[STR_NUMBER_SIZE];
+	uint24_t lengthA = valueTextLength(a);
+	uint24_t lengthB = valueTextLength(b);
+	string_t *str;
+	uint8_t depth;
+
+	if(lengthA + lengthB < STR_MIN_ROPE) {
+		/* Short enough that copying is cheaper than a rope */
+		char text[STR_MIN_ROPE];
+		memcpy(text, valueToText(a, bufA), lengthA);
+		memcpy(text + lengthA, valueToText(b, bufB), lengthB);
+		str = copyString(text, lengthA + lengthB);
+		return str ? stringValue(str) : noneValue();
+	}
+
+	/* Ropes can only hold text, so make strings out of anything else */
+	if(!isText(a)) {
+		str = copyString(valueToText(a, bufA), lengthA);
+		if(!str) return noneValue();
+		a = stringValue(str);
+	}
+	if(!isText(b)) {
+		str = copyString(valueToText(b, bufB), lengthB);
+		if(!str) return noneValue();
+		b = stringValue(str);
+	}
+
+	str = newString(STR_ROPE, lengthA + lengthB);
+	if(!str) return noneValue();
+
+	str->as.rope.left = a;
+	str->as.rope.right = b;
+	gcWriteBarrier(str);
+
+	depth = ropeDepth(b) + 1;
+	if(ropeDepth(a) > depth) depth = ropeDepth(a);
+	str->depth = depth;
+
+	/* Keep flattening from recursing too deeply */
+	if(depth > STR_MAX_DEPTH) strFlatten(str);
+
+	return stringValue(str);
+}
+
+value_t strLetter(value_t val, uint24_t index) {
+	char buf[STR_NUMBER_SIZE];
+	const char *text;
+	string_t *str;
+	uint8_t letter;
+
+	if(index >= valueTextLength(val)) return textValue("");
+
+	text = valueToText(val, buf);
+	letter = text[index];
+
+	if(letter < 128) {
+		letters[letter * 2] = letter;
+		return textValue(&letters[letter * 2]);
+	}
+
+	str = copyString(&text[index], 1);
+	return str ? stringValue(str) : noneValue();
+}
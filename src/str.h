@@ -0,0 +1,69 @@
+#ifndef H_STR
+#define H_STR
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "value.h"
+#include "gc.h"
+
+/* Strings this long or shorter are stored inside the string object */
+#define STR_INLINE_SIZE	11
+/* Joins shorter than this are copied, rather than making a rope */
+#define STR_MIN_ROPE	32
+/* How deeply ropes may nest on the right before they are flattened */
+#define STR_MAX_DEPTH	16
+/* Big enough for any number, as text */
+#define STR_NUMBER_SIZE	16
+
+enum StringKinds {
+	STR_SHORT,	/* as.chars */
+	STR_FLAT,	/* as.ptr, allocated along with the string */
+	STR_ROPE	/* as.rope, the concatenation of two texts */
+};
+
+/* A string created while running, garbage collected */
+/* String literals aren't copied into these, but are used in place as VAL_TEXT */
+typedef struct String {
+	gcHeader_t gc;
+	uint8_t kind;
+	uint8_t depth;		/* Ropes nested on the right, for STR_ROPE */
+	uint24_t length;
+	union {
+		char chars[STR_INLINE_SIZE + 1];
+		char *ptr;
+		struct {
+			value_t left;
+			value_t right;
+		} rope;
+	} as;
+} string_t;
+
+#define isText(val) ((val).type == VAL_TEXT || (val).type == VAL_STRING)
+
+/* Get a value as a null-terminated string */
+/* Ropes are flattened, and numbers are written into buf, which is STR_NUMBER_SIZE long */
+const char *valueToText(value_t val, char *buf);
+
+uint24_t valueTextLength(value_t val);
+
+/* Join two values as text, returns nothing if out of memory */
+/* Long results are ropes, which are only copied when they need to be read */
+value_t strJoin(value_t a, value_t b);
+
+/* Get a single letter, using a 0-based index */
+/* Letters are shared, so this never allocates */
+value_t strLetter(value_t val, uint24_t index);
+
+/* Copy a flattened rope's text into the string itself */
+/* Returns false if out of memory */
+bool strFlatten(string_t *str);
+
+#endif
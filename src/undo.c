@@ -0,0 +1,218 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "undo.h"
+
+#define ENTRY_SIZE(count) (sizeof(undoEntry_t) + (count) * sizeof(scriptElem_t))
+#define ENTRY_ELEMS(entry) ((scriptElem_t*)((entry) + 1))
+
+bool undoInit(undoLog_t *log, workspace_t *ws, uint24_t budget) {
+	log->ws = ws;
+	log->buffer = malloc(budget);
+	log->budget = log->buffer ? budget : 0;
+	log->lastSize = 0;
+	undoClear(log);
+	return log->buffer != NULL;
+}
+
+void undoFree(undoLog_t *log) {
+	free(log->buffer);
+	log->buffer = NULL;
+	log->budget = 0;
+	undoClear(log);
+}
+
+void undoClear(undoLog_t *log) {
+	log->undoEnd = 0;
+	log->end = 0;
+	log->topSize = 0;
+}
+
+/* Throw away the oldest entry, moving the rest to the start of the buffer */
+static void evictOldest(undoLog_t *log) {
+	uint24_t size = ((undoEntry_t*)log->buffer)->size;
+
+	memmove(log->buffer, log->buffer + size, log->end - size);
+	log->end -= size;
+	log->undoEnd -= size;
+
+	if(log->end) {
+		((undoEntry_t*)log->buffer)->prevSize = 0;
+	} else {
+		log->topSize = 0;
+	}
+}
+
+/* Make room for a new entry, returning where it goes */
+/* Returns NULL if it's too big for the log, in which case the log is cleared */
+static undoEntry_t *reserve(undoLog_t *log, uint24_t size) {
+	/* A new edit replaces anything that could have been redone */
+	log->end = log->undoEnd;
+
+	if(size > log->budget) {
+		dbg_sprintf(dbgerr, "Edit of %u bytes is too big to undo\n", size);
+		undoClear(log);
+		log->lastSize = 0;
+		return NULL;
+	}
+
+	while(log->end + size > log->budget) {
+		evictOldest(log);
+	}
+
+	return (undoEntry_t*)&log->buffer[log->end];
+}
+
+/* Fill in a reserved entry and add it to the log */
+static void logEntry(undoLog_t *log, undoEntry_t *entry, uint8_t op, workspaceScript_t *script, uint24_t index, uint24_t count, char *data) {
+	entry->size = ENTRY_SIZE(count);
+	entry->prevSize = log->undoEnd ? log->topSize : 0;
+	entry->op = op;
+	entry->scriptId = script->id;
+	entry->index = index;
+	entry->count = count;
+	entry->data = data;
+
+	log->end += entry->size;
+	log->undoEnd = log->end;
+	log->topSize = entry->size;
+	log->lastSize = entry->size;
+
+	#ifdef DBG_UNDO
+	dbg_sprintf(dbgout, "logged edit %u of %u elems: %u bytes, %u of %u used\n",
+		op, count, entry->size, log->end, log->budget);
+	#endif
+}
+
+/* Drawing and hit testing use caches that are the length of the script */
+static void remeasure(workspaceScript_t *script) {
+	if(!workspaceInvalidate(script)) {
+		dbg_sprintf(dbgerr, "Out of memory measuring script %u after an edit\n", script->id);
+	}
+}
+
+bool editInsert(undoLog_t *log, workspaceScript_t *script, uint24_t index, const scriptElem_t *elems, uint24_t count) {
+	scriptElem_t *result = scriptInsert(script->elems, index, elems, count);
+	undoEntry_t *entry;
+
+	if(!result) return false;
+	script->elems = result;
+	remeasure(script);
+
+	entry = log ? reserve(log, ENTRY_SIZE(count)) : NULL;
+	if(entry) {
+		memcpy(ENTRY_ELEMS(entry), elems, count * sizeof(scriptElem_t));
+		logEntry(log, entry, UNDO_INSERT, script, index, count, NULL);
+	}
+
+	return true;
+}
+
+bool editDelete(undoLog_t *log, workspaceScript_t *script, uint24_t index, uint24_t count) {
+	undoEntry_t *entry = log ? reserve(log, ENTRY_SIZE(count)) : NULL;
+
+	/* The deleted elems are copied straight into the log */
+	script->elems = scriptDelete(script->elems, index, count, entry ? ENTRY_ELEMS(entry) : NULL);
+	remeasure(script);
+
+	if(entry) logEntry(log, entry, UNDO_DELETE, script, index, count, NULL);
+
+	return true;
+}
+
+bool editSetLiteral(undoLog_t *log, workspaceScript_t *script, uint24_t index, char *data) {
+	scriptElem_t *elem = &script->elems[index];
+	char *old = elem->data;
+	undoEntry_t *entry;
+
+	elem->data = data;
+	remeasure(script);
+
+	entry = log ? reserve(log, ENTRY_SIZE(0)) : NULL;
+	if(entry) {
+		logEntry(log, entry, UNDO_SET, script, index, 0, old);
+	}
+
+	return true;
+}
+
+/* Redo an entry, or undo it if reverse is set */
+static bool applyEntry(undoEntry_t *entry, workspaceScript_t *script, bool reverse) {
+	scriptElem_t *result;
+	char *data;
+
+	switch(entry->op) {
+		case UNDO_SET:
+			/* Swap the data in the script with the data in the entry, which works both ways */
+			data = script->elems[entry->index].data;
+			script->elems[entry->index].data = entry->data;
+			entry->data = data;
+			break;
+
+		case UNDO_INSERT:
+		case UNDO_DELETE:
+			/* Undoing a delete is an insert, and the other way round */
+			if((entry->op == UNDO_INSERT) != reverse) {
+				result = scriptInsert(script->elems, entry->index, ENTRY_ELEMS(entry), entry->count);
+				if(!result) return false;
+				script->elems = result;
+			} else {
+				script->elems = scriptDelete(script->elems, entry->index, entry->count, NULL);
+			}
+			break;
+
+		default:
+			return false;
+	}
+
+	remeasure(script);
+	return true;
+}
+
+bool undo(undoLog_t *log, workspaceScript_t **edited) {
+	workspaceScript_t *script = NULL;
+	undoEntry_t *entry;
+
+	/* Edits to scripts that have been removed can't be undone, so they are passed over */
+	while(!script) {
+		if(!log->undoEnd) return false;
+
+		entry = (undoEntry_t*)&log->buffer[log->undoEnd - log->topSize];
+		script = workspaceGet(log->ws, entry->scriptId);
+		if(script && !applyEntry(entry, script, true)) return false;
+
+		log->undoEnd -= entry->size;
+		log->topSize = entry->prevSize;
+	}
+
+	if(edited) *edited = script;
+	return true;
+}
+
+bool redo(undoLog_t *log, workspaceScript_t **edited) {
+	workspaceScript_t *script = NULL;
+	undoEntry_t *entry;
+
+	while(!script) {
+		if(log->undoEnd == log->end) return false;
+
+		entry = (undoEntry_t*)&log->buffer[log->undoEnd];
+		script = workspaceGet(log->ws, entry->scriptId);
+		if(script && !applyEntry(entry, script, false)) return false;
+
+		log->undoEnd += entry->size;
+		log->topSize = entry->size;
+	}
+
+	if(edited) *edited = script;
+	return true;
+}
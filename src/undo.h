@@ -0,0 +1,83 @@
+#ifndef H_UNDO
+#define H_UNDO
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "workspace.h"
+
+/* Bytes of history kept if nothing else is asked for */
+#define UNDO_DEFAULT_BUDGET 2048
+
+enum UndoOps {
+	UNDO_INSERT,	/* Elems were inserted, and are stored after the entry */
+	UNDO_DELETE,	/* Elems were deleted, and are stored after the entry */
+	UNDO_SET		/* An elem's data was replaced */
+};
+
+/* One edit, stored in the log's buffer */
+/* Inserts and deletes are followed by a detached copy of the elems */
+typedef struct UndoEntry {
+	uint24_t size;			/* Bytes taken by the entry, including its elems */
+	uint24_t prevSize;		/* Size of the entry before this one, or 0 if it's the oldest */
+	uint8_t op;
+	uint24_t scriptId;		/* Of the edited workspace script, which can move around in the workspace */
+	uint24_t index;			/* Of the first elem edited */
+	uint24_t count;			/* Number of elems after the entry */
+	char *data;				/* For UNDO_SET, whichever data isn't in the script right now */
+} undoEntry_t;
+
+/* Edits, oldest first, in a buffer that never grows */
+/* When a new edit doesn't fit, the oldest ones are thrown away */
+typedef struct UndoLog {
+	workspace_t *ws;	/* Holding the scripts that are edited */
+	uint8_t *buffer;
+	uint24_t budget;	/* Size of buffer */
+	uint24_t undoEnd;	/* Entries before this offset can be undone */
+	uint24_t end;		/* Entries from undoEnd up to this offset can be redone */
+	uint24_t topSize;	/* Size of the entry just before undoEnd */
+	uint24_t lastSize;	/* Bytes used by the last edit, or 0 if it was too big to log */
+} undoLog_t;
+
+/* Returns false if out of memory */
+bool undoInit(undoLog_t *log, workspace_t *ws, uint24_t budget);
+void undoFree(undoLog_t *log);
+
+/* Forget every edit */
+/* Edits to scripts that have been removed from the workspace are skipped, so this isn't needed before freeing one */
+void undoClear(undoLog_t *log);
+
+/* Bytes used by every edit in the log */
+#define undoUsed(log) ((log)->end)
+
+/* Edit a workspace script, logging the edit so that it can be undone */
+/* The script's elems are updated if they move, and its caches are invalidated, see workspaceInvalidate */
+/* Making an edit forgets anything that could have been redone */
+/* log may be NULL to make an edit without logging it */
+/* Returns false if out of memory, in which case the script is unchanged */
+
+/* Insert count detached elems before index, see scriptInsert */
+bool editInsert(undoLog_t *log, workspaceScript_t *script, uint24_t index, const scriptElem_t *elems, uint24_t count);
+/* Delete count elems starting at index, see scriptDelete */
+bool editDelete(undoLog_t *log, workspaceScript_t *script, uint24_t index, uint24_t count);
+/* Change a literal's data */
+bool editSetLiteral(undoLog_t *log, workspaceScript_t *script, uint24_t index, char *data);
+
+/* Undo the last edit, or redo the last one that was undone */
+/* The edited script is invalidated like it is for an edit, and stored in edited if that isn't NULL */
+/* Returns false if there's nothing to undo or redo, or if out of memory */
+bool undo(undoLog_t *log, workspaceScript_t **edited);
+bool redo(undoLog_t *log, workspaceScript_t **edited);
+
+/* Comment this out to stop logging how much memory each edit takes */
+#define DBG_UNDO
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "value.h"
+#include "str.h"
+
+value_t noneValue(void) {
+	value_t val;
+	val.type = VAL_NONE;
+	val.as.list = NULL;
+	return val;
+}
+
+value_t boolValue(bool b) {
+	value_t val;
+	val.type = VAL_BOOL;
+	val.as.boolean = b;
+	return val;
+}
+
+value_t numberValue(float n) {
+	value_t val;
+	val.type = VAL_NUMBER;
+	val.as.number = n;
+	return val;
+}
+
+value_t textValue(const char *text) {
+	value_t val;
+	val.type = VAL_TEXT;
+	val.as.text = text;
+	return val;
+}
+
+value_t listValue(struct List *list) {
+	value_t val;
+	val.type = VAL_LIST;
+	val.as.list = list;
+	return val;
+}
+
+value_t closureValue(struct Closure *closure) {
+	value_t val;
+	val.type = VAL_CLOSURE;
+	val.as.closure = closure;
+	return val;
+}
+
+value_t stringValue(struct String *string) {
+	value_t val;
+	val.type = VAL_STRING;
+	val.as.string = string;
+	return val;
+}
+
+/* Returns true and sets *result if text is entirely a number */
+static bool parseNumber(const char *text, float *result) {
+	char *end;
+
+	/* Empty text is not a number */
+	if(!*text) return false;
+
+	*result = (float)strtod(text, &end);
+	return !*end;
+}
+
+/* Returns true and sets *result if the value is a number, or text that is one */
+static bool isNumeric(value_t val, float *result) {
+	char buf[STR_NUMBER_SIZE];
+
+	if(val.type == VAL_NUMBER) {
+		*result = val.as.number;
+		return true;
+	}
+
+	return isText(val) && parseNumber(valueToText(val, buf), result);
+}
+
+float valueToNumber(value_t val) {
+	float num;
+
+	if(val.type == VAL_BOOL) return val.as.boolean;
+	if(isNumeric(val, &num)) return num;
+	return 0;
+}
+
+bool valueIsTrue(value_t val) {
+	return val.type == VAL_BOOL && val.as.boolean;
+}
+
+bool valueEquals(value_t a, value_t b) {
+	char bufA[STR_NUMBER_SIZE], bufB[STR_NUMBER_SIZE];
+	float numA, numB;
+	const char *textA, *textB;
+
+	/* Compare as numbers if both sides are numeric */
+	if(isNumeric(a, &numA) && isNumeric(b, &numB)) return numA == numB;
+
+	/* Literals and strings made while running can be compared with each other */
+	if(isText(a) && isText(b)) {
+		for(textA = valueToText(a, bufA), textB = valueToText(b, bufB); *textA; textA++, textB++) {
+			if(tolower(*textA) != tolower(*textB)) return false;
+		}
+		return !*textB;
+	}
+
+	if(a.type != b.type) return false;
+
+	switch(a.type) {
+		case VAL_NONE:
+			return true;
+		case VAL_BOOL:
+			return a.as.boolean == b.as.boolean;
+		default:
+			/* Lists and rings are only equal to themselves */
+			return a.as.list == b.as.list;
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef H_VALUE
+#define H_VALUE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum ValueTypes {
+	VAL_NONE,		/* Nothing, e.g. an empty slot */
+	VAL_BOOL,		/* as.boolean */
+	VAL_NUMBER,		/* as.number */
+	VAL_TEXT,		/* as.text - pointer to a string owned by the script, never copied */
+	VAL_LIST,		/* as.list */
+	VAL_CLOSURE,	/* as.closure - a ring */
+	VAL_STRING,		/* as.string - text created while running */
+	NUM_VALUE_TYPES	/* Not an actual value type */
+};
+typedef uint8_t valueType_t;
+
+struct List;
+struct Closure;
+struct String;
+
+/* A runtime value, small enough to be passed around by value */
+typedef struct Value {
+	valueType_t type;
+	union {
+		bool boolean;
+		float number;
+		const char *text;
+		struct List *list;
+		struct Closure *closure;
+		struct String *string;
+	} as;
+} value_t;
+
+/* Variable definitions, pointed to by VARIABLE and UPVAR elems */
+/* value holds the global value, local values are bound in environments */
+/* Globals are garbage collector roots once they have been set, see gcAddVariable */
+typedef struct Variable {
+	char *name;
+	value_t value;
+	uint24_t version;	/* Changed whenever the variable is set, so that watchers know to redraw */
+	struct Variable *nextRoot;	/* Next global the garbage collector marks */
+	bool rooted;
+} variable_t;
+
+value_t noneValue(void);
+value_t boolValue(bool b);
+value_t numberValue(float n);
+value_t textValue(const char *text);
+value_t listValue(struct List *list);
+value_t closureValue(struct Closure *closure);
+value_t stringValue(struct String *string);
+
+/* Conversions follow Snap, e.g. text that isn't a number is 0 */
+float valueToNumber(value_t val);
+bool valueIsTrue(value_t val);
+/* Text is compared case-insensitively, and numeric text as a number */
+bool valueEquals(value_t a, value_t b);
+
+#endif
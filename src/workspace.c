@@ -0,0 +1,272 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+#include "workspace.h"
+#include "blockrender.h"
+
+bool workspaceInit(workspace_t *ws) {
+	ws->scripts = malloc(WORKSPACE_INITIAL_CAPACITY * sizeof(workspaceScript_t));
+	ws->numScripts = 0;
+	ws->capacity = WORKSPACE_INITIAL_CAPACITY;
+	ws->scrollX = 0;
+	ws->scrollY = 0;
+	ws->nextId = 0;
+	return ws->scripts != NULL;
+}
+
+static void freeCaches(workspaceScript_t *script) {
+	free(script->widthCache);
+	free(script->heightCache);
+	free(script->lengthCache);
+	script->widthCache = NULL;
+	script->heightCache = NULL;
+	script->lengthCache = NULL;
+}
+
+void workspaceFree(workspace_t *ws) {
+	uint24_t i;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		freeCaches(&ws->scripts[i]);
+	}
+
+	free(ws->scripts);
+	ws->scripts = NULL;
+	ws->numScripts = 0;
+	ws->capacity = 0;
+}
+
+bool workspaceInvalidate(workspaceScript_t *script) {
+	size_t length = getScriptLength(script->elems) + 1;
+
+	/* The script may have changed length, so start again from scratch */
+	freeCaches(script);
+	script->measured = false;
+
+	script->widthCache = calloc(length, sizeof(uint24_t));
+	script->heightCache = calloc(length, sizeof(uint24_t));
+	script->lengthCache = calloc(length, sizeof(uint24_t));
+	if(!script->widthCache || !script->heightCache || !script->lengthCache) {
+		freeCaches(script);
+		return false;
+	}
+
+	layoutStart(&script->layout, script->elems, script->widthCache, script->heightCache);
+	return true;
+}
+
+workspaceScript_t *workspaceAdd(workspace_t *ws, scriptElem_t *elems, int24_t x, int24_t y) {
+	workspaceScript_t *script;
+
+	if(ws->numScripts == ws->capacity) {
+		workspaceScript_t *scripts = realloc(ws->scripts, 2 * ws->capacity * sizeof(workspaceScript_t));
+		if(!scripts) return NULL;
+		ws->scripts = scripts;
+		ws->capacity *= 2;
+	}
+
+	script = &ws->scripts[ws->numScripts];
+	script->elems = elems;
+	script->id = ws->nextId;
+	script->x = x;
+	script->y = y;
+	script->widthCache = NULL;
+	script->heightCache = NULL;
+	script->lengthCache = NULL;
+	if(!workspaceInvalidate(script)) return NULL;
+
+	ws->numScripts++;
+	ws->nextId++;
+	return script;
+}
+
+workspaceScript_t *workspaceFind(workspace_t *ws, scriptElem_t *elems) {
+	uint24_t i;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		if(ws->scripts[i].elems == elems) return &ws->scripts[i];
+	}
+
+	return NULL;
+}
+
+workspaceScript_t *workspaceGet(workspace_t *ws, uint24_t id) {
+	uint24_t i;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		if(ws->scripts[i].id == id) return &ws->scripts[i];
+	}
+
+	return NULL;
+}
+
+void workspaceRemove(workspace_t *ws, scriptElem_t *elems) {
+	workspaceScript_t *script = workspaceFind(ws, elems);
+	workspaceScript_t *end = &ws->scripts[ws->numScripts];
+
+	if(!script) return;
+
+	freeCaches(script);
+
+	/* Keep the rest in order, since later scripts are drawn on top */
+	memmove(script, script + 1, (end - script - 1) * sizeof(workspaceScript_t));
+	ws->numScripts--;
+}
+
+void workspacePan(workspace_t *ws, int24_t dx, int24_t dy) {
+	ws->scrollX += dx;
+	ws->scrollY += dy;
+}
+
+/* Find a script's bounding box, the same way drawScript stacks its blocks */
+static void measureScript(workspaceScript_t *script) {
+	scriptElem_t *elem = script->elems;
+	scriptElem_t *next;
+
+	script->width = 0;
+	script->height = 0;
+
+	while(elem->type != END_SCRIPT) {
+		uint24_t offset = elem - script->elems;
+		uint24_t width = getWidth(elem, NULL, script->widthCache + offset);
+
+		if(width > script->width) script->width = width;
+		script->height += getHeight(elem, NULL, script->heightCache + offset);
+
+		/* Skip to the next block, past this one's BLOCK_END */
+		if(!script->lengthCache[offset]) script->lengthCache[offset] = getLength(elem);
+		next = elem + script->lengthCache[offset];
+		if(next->type == BLOCK_END && next->data == (void*)elem) next++;
+		elem = next;
+	}
+
+	/* The notch under the last block sticks out of it */
+	script->height += NOTCH_DEPTH;
+	script->measured = true;
+}
+
+/* Get where a script is on the screen, and whether any of it is onscreen */
+/* Scripts that aren't laid out far enough to draw count as offscreen */
+static bool getScreenPos(workspace_t *ws, workspaceScript_t *script, int24_t *x, int24_t *y) {
+	/* Out of memory the last time it was invalidated */
+	if(!script->widthCache) return false;
+
+	*x = script->x - ws->scrollX;
+	*y = script->y - ws->scrollY;
+
+	if(!layoutDone(&script->layout)) {
+		/* The blocks that are done have to reach the bottom of the screen, since drawScript stops there */
+		return *x < (int24_t)LCD_WIDTH && *y < (int24_t)LCD_HEIGHT &&
+		       *y + (int24_t)script->layout.height >= (int24_t)LCD_HEIGHT;
+	}
+
+	if(!script->measured) measureScript(script);
+
+	return *x < (int24_t)LCD_WIDTH && *x + (int24_t)script->width > 0 &&
+	       *y < (int24_t)LCD_HEIGHT && *y + (int24_t)script->height > 0;
+}
+
+/* How many rows of a script have to be laid out before the part of it that's onscreen can be drawn */
+static uint24_t getVisibleRows(workspace_t *ws, workspaceScript_t *script) {
+	int24_t x = script->x - ws->scrollX;
+	int24_t y = script->y - ws->scrollY;
+
+	/* Scripts that start below or to the right of the screen can't be seen at all */
+	if(x >= (int24_t)LCD_WIDTH || y >= (int24_t)LCD_HEIGHT) return 0;
+
+	return LCD_HEIGHT - y;
+}
+
+/* Run the layout jobs that aren't done, either just far enough to draw what's onscreen or all the way */
+/* Returns false if it ran out of time */
+static bool runLayouts(workspace_t *ws, uint24_t start, bool visibleOnly, bool *worked) {
+	uint24_t i;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		workspaceScript_t *script = &ws->scripts[i];
+		uint24_t rows = visibleOnly ? getVisibleRows(ws, script) : LAYOUT_ALL_ROWS;
+
+		if(!script->widthCache || layoutDone(&script->layout) || script->layout.height >= rows) continue;
+
+		*worked = true;
+		if(!layoutRun(&script->layout, start, rows)) return false;
+	}
+
+	return true;
+}
+
+bool workspaceLayout(workspace_t *ws) {
+	uint24_t start = timer_1_Counter;
+	bool worked = false;
+	bool done;
+
+	/* Get everything that's onscreen ready to draw first, then use whatever time is left on the rest */
+	done = runLayouts(ws, start, true, &worked) && runLayouts(ws, start, false, &worked);
+
+	if(worked) layoutEndSlice(start);
+	return done;
+}
+
+bool workspaceDraw(workspace_t *ws, bool *csrOver) {
+	uint24_t i;
+	uint24_t drawn = 0;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		workspaceScript_t *script = &ws->scripts[i];
+		int24_t x, y;
+
+		if(!getScreenPos(ws, script, &x, &y)) continue;
+
+		if(!drawScript(script->elems, x, y, csrOver, script->widthCache, script->heightCache)) return false;
+		drawn++;
+	}
+
+	#ifdef DBG_DRAW
+	dbg_sprintf(dbgout, "drew %u of %u scripts\n", drawn, ws->numScripts);
+	#endif
+
+	return true;
+}
+
+scriptElem_t *workspaceHitTest(workspace_t *ws, int24_t csrX, int24_t csrY) {
+	uint24_t i;
+
+	/* Scripts drawn last are on top */
+	for(i = ws->numScripts; i-- > 0;) {
+		workspaceScript_t *script = &ws->scripts[i];
+		scriptElem_t *hit;
+		int24_t x, y;
+
+		if(!getScreenPos(ws, script, &x, &y)) continue;
+		if(script->measured && (csrX < x || csrX >= x + (int24_t)script->width || csrY < y || csrY >= y + (int24_t)script->height)) continue;
+
+		hit = hitTest(script->elems, x, y, csrX, csrY, script->widthCache, script->heightCache, script->lengthCache);
+		if(hit) return hit;
+	}
+
+	return NULL;
+}
+
+bool workspaceAddDropTargets(workspace_t *ws, dropIndex_t *index) {
+	uint24_t i;
+
+	for(i = 0; i < ws->numScripts; i++) {
+		workspaceScript_t *script = &ws->scripts[i];
+		int24_t x, y;
+
+		if(!layoutDone(&script->layout) || !getScreenPos(ws, script, &x, &y)) continue;
+
+		if(!dropAddScript(index, script->elems, x, y, script->widthCache, script->heightCache)) return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef H_WORKSPACE
+#define H_WORKSPACE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "drop.h"
+#include "layout.h"
+
+/* Number of scripts there is room for before the first one is added */
+#define WORKSPACE_INITIAL_CAPACITY 8
+
+/* A script placed somewhere in a workspace */
+typedef struct WorkspaceScript {
+	scriptElem_t *elems;
+	uint24_t id;			/* Stays the same while the script is in the workspace, unlike its address */
+	int24_t x;				/* Top left corner, in workspace coordinates */
+	int24_t y;
+	uint24_t width;			/* Bounding box, only valid if measured is set */
+	uint24_t height;
+	bool measured;
+	uint24_t *widthCache;	/* Caches for drawing and hit testing, each the length of the script */
+	uint24_t *heightCache;
+	uint24_t *lengthCache;
+	layoutJob_t layout;		/* Fills in widthCache and heightCache */
+} workspaceScript_t;
+
+/* Every script belonging to a sprite, and the part of them that is onscreen */
+typedef struct Workspace {
+	workspaceScript_t *scripts;
+	uint24_t numScripts;
+	uint24_t capacity;
+	int24_t scrollX;		/* Workspace coordinates of the top left corner of the screen */
+	int24_t scrollY;
+	uint24_t nextId;		/* Given to the next script added */
+} workspace_t;
+
+/* Returns false if out of memory */
+bool workspaceInit(workspace_t *ws);
+/* The scripts themselves are left alone */
+void workspaceFree(workspace_t *ws);
+
+/* Add a script with its top left corner at x, y in workspace coordinates */
+/* Returns NULL if out of memory */
+workspaceScript_t *workspaceAdd(workspace_t *ws, scriptElem_t *elems, int24_t x, int24_t y);
+
+/* Take a script out of the workspace, without freeing it */
+/* Pointers to the workspace's other scripts may move */
+void workspaceRemove(workspace_t *ws, scriptElem_t *elems);
+
+/* Find the workspace script for some elems, or NULL if they aren't in the workspace */
+workspaceScript_t *workspaceFind(workspace_t *ws, scriptElem_t *elems);
+
+/* Find a workspace script by its id, or NULL if it has been removed */
+workspaceScript_t *workspaceGet(workspace_t *ws, uint24_t id);
+
+/* Throw away a script's measurements, after it has been edited */
+/* It won't be drawn again until enough of it has been laid out by workspaceLayout */
+/* Returns false if out of memory */
+bool workspaceInvalidate(workspaceScript_t *script);
+
+/* Move the view by some number of pixels */
+void workspacePan(workspace_t *ws, int24_t dx, int24_t dy);
+
+/* Lay out scripts for about layoutBudget ticks, starting with the parts that are onscreen */
+/* This should be called once per frame, between checks for input */
+/* Returns true once every script is laid out */
+bool workspaceLayout(workspace_t *ws);
+
+/* Draw every script that is at least partly onscreen */
+/* Scripts that haven't been laid out down to the bottom of the screen yet are skipped */
+/* Scripts that are entirely offscreen are skipped without looking at their elems */
+/* csrOver is the same as for drawScript */
+/* Returns false if error */
+bool workspaceDraw(workspace_t *ws, bool *csrOver);
+
+/* Find the deepest element under a point on the screen, or NULL if there isn't one */
+scriptElem_t *workspaceHitTest(workspace_t *ws, int24_t csrX, int24_t csrY);
+
+/* Add the drop targets of every onscreen script to an index, in screen coordinates */
+/* Scripts that haven't been laid out completely are left out */
+/* Returns false if out of memory */
+bool workspaceAddDropTargets(workspace_t *ws, dropIndex_t *index);
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <graphx.h>
+
+#include "label.h"
+#include "shape.h"
+
+#include "gfx/gfx_group.h"
+
+/* graphx and the label and shape caches, for measuring blocks on a PC */
+/* Nothing here keeps any state, so every thread can measure blocks at once */
+
+/* Widths of the glyphs in graphx's default font */
+static const uint8_t charWidths[128] = {
+	8,8,8,8,8,8,8,8,8,8,8,8,8,2,8,8,
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
+	3,4,6,8,8,8,8,5,5,5,8,7,4,7,3,8,
+	8,7,8,8,8,8,8,8,8,8,3,4,6,7,6,7,
+	8,8,8,8,8,8,8,8,8,4,8,8,8,8,8,8,
+	8,8,8,8,8,8,8,8,8,8,8,5,8,5,8,8,
+	4,8,8,8,8,8,8,8,8,4,7,7,4,8,8,8,
+	8,8,8,8,7,8,8,8,8,8,8,6,3,6,8,8
+};
+
+/* Sprites with the same sizes as the ones in src/gfx */
+static uint8_t colorsData[2 + 16 * 4] = {16, 4};
+static uint8_t hatData[2 + 69 * 9] = {69, 9};
+static uint8_t flagData[2 + 15 * 15] = {15, 15};
+
+gfx_sprite_t *colors = (gfx_sprite_t*)colorsData;
+gfx_sprite_t *hat = (gfx_sprite_t*)hatData;
+gfx_sprite_t *flag = (gfx_sprite_t*)flagData;
+
+uint8_t gfx_SetColor(uint8_t index) {
+	return index;
+}
+
+void gfx_SetTextScale(uint8_t widthScale, uint8_t heightScale) {
+}
+
+unsigned int gfx_GetCharWidth(const char c) {
+	return charWidths[c & 0x7F];
+}
+
+unsigned int gfx_GetStringWidth(const char *string) {
+	unsigned int width = 0;
+
+	while(*string) width += gfx_GetCharWidth(*string++);
+	return width;
+}
+
+void gfx_HorizLine(int x, int y, int length) {
+}
+
+void gfx_Rectangle(int x, int y, int width, int height) {
+}
+
+void gfx_FillRectangle(int x, int y, int width, int height) {
+}
+
+void gfx_FillCircle(int x, int y, unsigned int radius) {
+}
+
+void gfx_TransparentSprite(gfx_sprite_t *sprite, int x, int y) {
+}
+
+/* Text is measured every time, rather than cached by address */
+
+label_t *getLabel(const char *text) {
+	return NULL;
+}
+
+void drawLabel(label_t *label, int24_t x, int24_t y, uint8_t color) {
+}
+
+void drawText(const char *text, int24_t x, int24_t y, uint8_t color) {
+}
+
+uint24_t textWidth(const char *text) {
+	return gfx_GetStringWidth(text);
+}
+
+void labelForget(const char *text) {
+}
+
+void labelFreeCache(void) {
+}
+
+shape_t *getShape(uint8_t kind, uint24_t width, uint24_t height, uint8_t capWidth) {
+	return NULL;
+}
+
+void drawShape(shape_t *shape, int24_t x, int24_t y, uint24_t width, const blockPalette_t *pal) {
+}
+
+void shapeFreeCache(void) {
+}
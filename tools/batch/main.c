@@ -0,0 +1,342 @@
+/* snapbatch - check and convert a library of projects on a PC, using every core */
+/* Usage: snapbatch [-j workers] [-o outdir] [-q] path... */
+/* Each path is a project in the text form described in project.h, or a directory of them ending in .snp */
+/* With -o, each valid project is written to outdir in its binary form, with the extension .snb */
+/* outdir is created if it doesn't exist, but its parent has to */
+/* A line is printed for each project unless -q is given, followed by a summary */
+/* Exits with 1 if any project isn't valid */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "project.h"
+#include "pool.h"
+
+#define PROJECT_EXTENSION	".snp"
+#define BINARY_EXTENSION	".snb"
+
+/* One project to convert, and how it went */
+typedef struct Job {
+	char *path;
+	bool ok;
+	char error[PROJECT_ERROR_SIZE];
+	uint24_t numScripts;
+	uint24_t numElems;
+	size_t textSize;
+	size_t binarySize;
+	uint64_t parseNs;
+	uint64_t layoutNs;
+	uint64_t totalNs;
+	unsigned worker;
+} job_t;
+
+typedef struct Options {
+	const char *outDir;
+	unsigned workers;
+	bool quiet;
+} options_t;
+
+static uint64_t now(void) {
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static bool hasExtension(const char *name, const char *extension) {
+	size_t length = strlen(name);
+	size_t extLength = strlen(extension);
+
+	return length > extLength && !strcmp(name + length - extLength, extension);
+}
+
+/* Read a whole file, returning NULL if it can't be read */
+static char *readFile(const char *path, size_t *size) {
+	FILE *file = fopen(path, "rb");
+	char *text = NULL;
+	long length;
+
+	if(!file) return NULL;
+
+	if(!fseek(file, 0, SEEK_END) && (length = ftell(file)) >= 0 && !fseek(file, 0, SEEK_SET)) {
+		text = malloc(length + 1);
+		if(text && fread(text, 1, length, file) == (size_t)length) {
+			text[length] = 0;
+			*size = length;
+		} else {
+			free(text);
+			text = NULL;
+		}
+	}
+
+	fclose(file);
+	return text;
+}
+
+static bool writeOutput(const char *outDir, const char *path, const uint8_t *data, size_t size) {
+	const char *base = strrchr(path, '/');
+	size_t baseLength;
+	char *outPath;
+	FILE *file;
+	bool ok;
+
+	base = base ? base + 1 : path;
+	baseLength = strlen(base);
+	if(hasExtension(base, PROJECT_EXTENSION)) baseLength -= strlen(PROJECT_EXTENSION);
+
+	outPath = malloc(strlen(outDir) + baseLength + strlen(BINARY_EXTENSION) + 2);
+	if(!outPath) return false;
+	sprintf(outPath, "%s/%.*s%s", outDir, (int)baseLength, base, BINARY_EXTENSION);
+
+	file = fopen(outPath, "wb");
+	free(outPath);
+	if(!file) return false;
+
+	ok = fwrite(data, 1, size, file) == size;
+	return !fclose(file) && ok;
+}
+
+/* Convert one project, from any worker */
+static void runJob(void *item, unsigned worker, void *data) {
+	job_t *job = item;
+	const options_t *options = data;
+	uint64_t start = now();
+	uint64_t time;
+	project_t project;
+	uint8_t *binary;
+	char *text;
+
+	job->worker = worker;
+
+	text = readFile(job->path, &job->textSize);
+	if(!text) {
+		snprintf(job->error, PROJECT_ERROR_SIZE, "can't read file");
+		job->totalNs = now() - start;
+		return;
+	}
+
+	job->ok = projectParse(&project, text);
+	free(text);
+	time = now();
+	job->parseNs = time - start;
+
+	if(!job->ok) {
+		strcpy(job->error, project.error);
+		projectFree(&project);
+		job->totalNs = now() - start;
+		return;
+	}
+
+	/* Lay out every script with the calculator's own code */
+	job->numScripts = project.numScripts;
+	job->numElems = projectMeasure(&project);
+	job->layoutNs = now() - time;
+
+	binary = projectEncode(&project, &job->binarySize);
+	if(!binary) {
+		job->ok = false;
+		snprintf(job->error, PROJECT_ERROR_SIZE, "out of memory");
+	} else if(options->outDir && !writeOutput(options->outDir, job->path, binary, job->binarySize)) {
+		job->ok = false;
+		snprintf(job->error, PROJECT_ERROR_SIZE, "can't write output");
+	}
+
+	free(binary);
+	projectFree(&project);
+	job->totalNs = now() - start;
+}
+
+static bool addJob(job_t **jobs, size_t *numJobs, size_t *capacity, const char *path) {
+	job_t *job;
+
+	if(*numJobs == *capacity) {
+		job_t *result = realloc(*jobs, (*capacity ? *capacity * 2 : 64) * sizeof(job_t));
+		if(!result) return false;
+		*jobs = result;
+		*capacity = *capacity ? *capacity * 2 : 64;
+	}
+
+	job = &(*jobs)[(*numJobs)++];
+	memset(job, 0, sizeof(job_t));
+	job->path = strdup(path);
+	return job->path != NULL;
+}
+
+static int comparePaths(const void *a, const void *b) {
+	return strcmp(((const job_t*)a)->path, ((const job_t*)b)->path);
+}
+
+/* Add a project, or every project in a directory */
+static bool addPath(job_t **jobs, size_t *numJobs, size_t *capacity, const char *path) {
+	DIR *dir = opendir(path);
+	struct dirent *entry;
+	char *child;
+	bool ok = true;
+
+	if(!dir) return addJob(jobs, numJobs, capacity, path);
+
+	while(ok && (entry = readdir(dir))) {
+		if(!hasExtension(entry->d_name, PROJECT_EXTENSION)) continue;
+
+		child = malloc(strlen(path) + strlen(entry->d_name) + 2);
+		if(!child) {
+			ok = false;
+			break;
+		}
+		sprintf(child, "%s/%s", path, entry->d_name);
+		ok = addJob(jobs, numJobs, capacity, child);
+		free(child);
+	}
+
+	closedir(dir);
+	return ok;
+}
+
+static double toMs(uint64_t ns) {
+	return ns / 1e6;
+}
+
+static void printJob(const job_t *job) {
+	if(!job->ok) {
+		printf("%s: error: %s\n", job->path, job->error);
+		return;
+	}
+
+	printf("%s: %u scripts, %u elems, %zu -> %zu bytes, parse %.3f ms, layout %.3f ms, worker %u\n",
+		job->path, (unsigned)job->numScripts, (unsigned)job->numElems, job->textSize, job->binarySize,
+		toMs(job->parseNs), toMs(job->layoutNs), job->worker);
+}
+
+static void printSummary(const job_t *jobs, size_t numJobs, const options_t *options, uint64_t wallNs, const poolStats_t *stats) {
+	uint64_t busyNs = 0;
+	uint64_t layoutNs = 0;
+	size_t textSize = 0;
+	size_t binarySize = 0;
+	size_t elems = 0;
+	size_t failed = 0;
+	double wall = wallNs / 1e9;
+	size_t i;
+
+	for(i = 0; i < numJobs; i++) {
+		busyNs += jobs[i].totalNs;
+		if(!jobs[i].ok) {
+			failed++;
+			continue;
+		}
+		layoutNs += jobs[i].layoutNs;
+		textSize += jobs[i].textSize;
+		binarySize += jobs[i].binarySize;
+		elems += jobs[i].numElems;
+	}
+
+	printf("%zu projects, %zu failed, in %.3f ms on %u workers\n", numJobs, failed, toMs(wallNs), options->workers);
+	printf("%zu elems, %zu -> %zu bytes\n", elems, textSize, binarySize);
+	printf("layout: %.3f ms total, %.0f elems/s per worker\n", toMs(layoutNs), layoutNs ? elems / (layoutNs / 1e9) : 0);
+	if(wall > 0) {
+		printf("throughput: %.1f projects/s, %.0f elems/s\n", numJobs / wall, elems / wall);
+		printf("workers busy %.0f%% of the time, %zu steals moved %zu projects\n",
+			100 * (busyNs / 1e9) / (wall * options->workers), stats->steals, stats->stolen);
+	}
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: snapbatch [-j workers] [-o outdir] [-q] path...\n");
+}
+
+int main(int argc, char **argv) {
+	options_t options;
+	job_t *jobs = NULL;
+	void **items;
+	size_t numJobs = 0;
+	size_t capacity = 0;
+	poolStats_t stats;
+	uint64_t start;
+	uint64_t wallNs;
+	bool failed = false;
+	long cores;
+	size_t i;
+	int opt;
+
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+	options.workers = cores > 0 ? cores : 1;
+	options.outDir = NULL;
+	options.quiet = false;
+
+	while((opt = getopt(argc, argv, "j:o:q")) != -1) {
+		switch(opt) {
+			case 'j':
+				options.workers = atoi(optarg);
+				if(!options.workers) options.workers = 1;
+				break;
+			case 'o':
+				options.outDir = optarg;
+				break;
+			case 'q':
+				options.quiet = true;
+				break;
+			default:
+				usage();
+				return 2;
+		}
+	}
+
+	if(optind == argc) {
+		usage();
+		return 2;
+	}
+
+	for(; optind < argc; optind++) {
+		if(!addPath(&jobs, &numJobs, &capacity, argv[optind])) {
+			fprintf(stderr, "snapbatch: out of memory\n");
+			return 2;
+		}
+	}
+
+	/* Report in a fixed order, whichever worker finishes first */
+	if(numJobs) qsort(jobs, numJobs, sizeof(job_t), comparePaths);
+
+	items = malloc((numJobs + 1) * sizeof(void*));
+	if(!items) {
+		fprintf(stderr, "snapbatch: out of memory\n");
+		return 2;
+	}
+	for(i = 0; i < numJobs; i++) items[i] = &jobs[i];
+
+	if(options.workers > numJobs && numJobs) options.workers = numJobs;
+
+	/* Otherwise every project would fail the same way */
+	if(options.outDir && mkdir(options.outDir, 0777) && errno != EEXIST) {
+		fprintf(stderr, "snapbatch: can't create %s: %s\n", options.outDir, strerror(errno));
+		return 2;
+	}
+
+	start = now();
+	if(!poolRun(items, numJobs, options.workers, runJob, &options, &stats)) {
+		fprintf(stderr, "snapbatch: couldn't start workers\n");
+		return 2;
+	}
+	wallNs = now() - start;
+
+	for(i = 0; i < numJobs; i++) {
+		if(!options.quiet || !jobs[i].ok) printJob(&jobs[i]);
+		if(!jobs[i].ok) failed = true;
+	}
+	printSummary(jobs, numJobs, &options, wallNs, &stats);
+
+	for(i = 0; i < numJobs; i++) free(jobs[i].path);
+	free(jobs);
+	free(items);
+
+	return failed ? 1 : 0;
+}
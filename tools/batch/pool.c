@@ -0,0 +1,174 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+/* A worker's items, which it takes from the tail of while others steal from the head */
+typedef struct Deque {
+	pthread_mutex_t lock;
+	size_t *items;		/* Indices into the pool's items, with room for all of them */
+	size_t head;
+	size_t tail;
+} deque_t;
+
+struct Pool;
+
+typedef struct Worker {
+	pthread_t thread;
+	unsigned id;
+	struct Pool *pool;
+	deque_t deque;
+	size_t *loot;		/* Where stolen items go on their way to the deque */
+	size_t steals;
+	size_t stolen;
+} worker_t;
+
+typedef struct Pool {
+	worker_t *workers;
+	unsigned numWorkers;
+	void **items;
+	poolFunc_t func;
+	void *data;
+} pool_t;
+
+static bool takeItem(deque_t *deque, size_t *item) {
+	bool found;
+
+	pthread_mutex_lock(&deque->lock);
+	found = deque->tail > deque->head;
+	if(found) *item = deque->items[--deque->tail];
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+/* Take the older half of a victim's items, returning how many were taken */
+static size_t stealFrom(worker_t *thief, deque_t *victim) {
+	size_t count;
+
+	pthread_mutex_lock(&victim->lock);
+	count = (victim->tail - victim->head + 1) / 2;
+	memcpy(thief->loot, &victim->items[victim->head], count * sizeof(size_t));
+	victim->head += count;
+	pthread_mutex_unlock(&victim->lock);
+
+	if(!count) return 0;
+
+	/* Only the thief adds to its own deque, and only once it's empty */
+	pthread_mutex_lock(&thief->deque.lock);
+	memcpy(thief->deque.items, thief->loot, count * sizeof(size_t));
+	thief->deque.head = 0;
+	thief->deque.tail = count;
+	pthread_mutex_unlock(&thief->deque.lock);
+
+	thief->steals++;
+	thief->stolen += count;
+	return count;
+}
+
+/* Look for a worker with items left, starting with the next one along */
+/* Returns false once every worker has run out, since nothing adds new items */
+static bool steal(worker_t *thief) {
+	pool_t *pool = thief->pool;
+	unsigned i;
+
+	for(i = 1; i < pool->numWorkers; i++) {
+		worker_t *victim = &pool->workers[(thief->id + i) % pool->numWorkers];
+		if(stealFrom(thief, &victim->deque)) return true;
+	}
+
+	return false;
+}
+
+static void *work(void *arg) {
+	worker_t *worker = arg;
+	pool_t *pool = worker->pool;
+	size_t item;
+
+	for(;;) {
+		if(!takeItem(&worker->deque, &item)) {
+			if(!steal(worker)) break;
+			continue;
+		}
+
+		pool->func(pool->items[item], worker->id, pool->data);
+	}
+
+	return NULL;
+}
+
+bool poolRun(void **items, size_t numItems, unsigned numWorkers, poolFunc_t func, void *data, poolStats_t *stats) {
+	pool_t pool;
+	unsigned started;
+	unsigned i;
+	size_t j;
+	bool ok = true;
+
+	if(!numWorkers) numWorkers = 1;
+
+	pool.workers = calloc(numWorkers, sizeof(worker_t));
+	if(!pool.workers) return false;
+	pool.numWorkers = numWorkers;
+	pool.items = items;
+	pool.func = func;
+	pool.data = data;
+
+	/* Give each worker a contiguous share of the items */
+	for(i = 0; i < numWorkers; i++) {
+		worker_t *worker = &pool.workers[i];
+		size_t first = numItems * i / numWorkers;
+		size_t last = numItems * (i + 1) / numWorkers;
+
+		worker->id = i;
+		worker->pool = &pool;
+		worker->deque.items = malloc((numItems + 1) * sizeof(size_t));
+		worker->loot = malloc((numItems + 1) * sizeof(size_t));
+		if(!worker->deque.items || !worker->loot) ok = false;
+		pthread_mutex_init(&worker->deque.lock, NULL);
+
+		if(!ok) continue;
+		for(j = first; j < last; j++) {
+			worker->deque.items[j - first] = j;
+		}
+		worker->deque.head = 0;
+		worker->deque.tail = last - first;
+	}
+
+	/* Fewer threads is fine, the ones that did start will steal the rest */
+	started = 0;
+	if(ok) {
+		for(i = 1; i < numWorkers; i++) {
+			if(pthread_create(&pool.workers[i].thread, NULL, work, &pool.workers[i])) break;
+			started++;
+		}
+		work(&pool.workers[0]);
+	}
+
+	for(i = 1; i <= started; i++) {
+		pthread_join(pool.workers[i].thread, NULL);
+	}
+
+	if(stats) {
+		stats->steals = 0;
+		stats->stolen = 0;
+		for(i = 0; i < numWorkers; i++) {
+			stats->steals += pool.workers[i].steals;
+			stats->stolen += pool.workers[i].stolen;
+		}
+	}
+
+	for(i = 0; i < numWorkers; i++) {
+		pthread_mutex_destroy(&pool.workers[i].deque.lock);
+		free(pool.workers[i].deque.items);
+		free(pool.workers[i].loot);
+	}
+	free(pool.workers);
+
+	return ok;
+}
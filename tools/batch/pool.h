@@ -0,0 +1,21 @@
+#ifndef H_POOL
+#define H_POOL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Called once for each item, from whichever worker ends up with it */
+typedef void (*poolFunc_t)(void *item, unsigned worker, void *data);
+
+typedef struct PoolStats {
+	size_t steals;		/* Times a worker that ran out of items took some from another */
+	size_t stolen;		/* Items moved by those steals */
+} poolStats_t;
+
+/* Run func on every item, across numWorkers threads */
+/* Each worker starts with an even share of the items, and takes half of another's remaining items when it runs out */
+/* Returns once every item is done, or false if the threads couldn't be started */
+bool poolRun(void **items, size_t numItems, unsigned numWorkers, poolFunc_t func, void *data, poolStats_t *stats);
+
+#endif
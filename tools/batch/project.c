@@ -0,0 +1,651 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "project.h"
+#include "blockrender.h"
+
+/* Most elems that can be inside each other at once */
+#define PARSE_MAX_DEPTH 256
+
+static const char *elemNames[NUM_ELEMENTS] = {
+	"END_SCRIPT",
+	"BLOCK_END",
+	"ON_GREEN_FLAG",
+	"ON_KEY",
+	"ON_CLICK",
+	"ON_CONDITION_START",
+	"ON_MESSAGE",
+	"ON_CLONE",
+	"CUSTOM_BLOCK_START",
+	"BLOCK_START",
+	"REPORTER_START",
+	"PREDICATE_START",
+	"BLOCK_RING_START",
+	"C_BLOCK_START",
+	"REPORTER_RING_START",
+	"HIDDEN_REPORTER_RING_START",
+	"PREDICATE_RING_START",
+	"HIDDEN_PREDICATE_RING_START",
+	"ARGLIST_START",
+	"BOOLEAN_LITERAL",
+	"STRING_LITERAL",
+	"FLOAT_LITERAL",
+	"VARIABLE",
+	"UPVAR",
+	"TITLE_TEXT"
+};
+
+static const char *categoryNames[] = {
+	"NO_CATEGORY",
+	"MOTION",
+	"LOOKS",
+	"SOUND",
+	"PEN",
+	"LISTS",
+	"CONTROL",
+	"SENSING",
+	"OPERATORS",
+	"VARIABLES",
+	"OTHER"
+};
+
+#define PRIMITIVE(id, category, slots, label, pure, func) #id,
+static const char *primitiveNames[NUM_PRIMATIVES] = {
+	#include "primtable.h"
+};
+#undef PRIMITIVE
+
+/* An elem that hasn't been ended yet */
+typedef struct OpenElem {
+	uint24_t start;		/* Index within the script */
+	uint24_t inputs;	/* Subelements so far, not counting title text */
+} openElem_t;
+
+typedef struct Parser {
+	project_t *project;
+	projectScript_t *script;	/* Script being added to, or NULL before the first one */
+	openElem_t open[PARSE_MAX_DEPTH];
+	uint24_t depth;
+	uint24_t line;
+} parser_t;
+
+static bool fail(parser_t *parser, const char *format, ...) {
+	char *error = parser->project->error;
+	va_list args;
+	int length;
+
+	length = parser->line ? snprintf(error, PROJECT_ERROR_SIZE, "line %u: ", (unsigned)parser->line) : 0;
+
+	va_start(args, format);
+	vsnprintf(error + length, PROJECT_ERROR_SIZE - length, format, args);
+	va_end(args);
+
+	return false;
+}
+
+/* Make room for one more item in an array */
+static bool grow(void **array, uint24_t *capacity, uint24_t count, size_t size) {
+	uint24_t newCapacity;
+	void *result;
+
+	if(count < *capacity) return true;
+
+	newCapacity = *capacity ? *capacity * 2 : 8;
+	result = realloc(*array, newCapacity * size);
+	if(!result) return false;
+
+	*array = result;
+	*capacity = newCapacity;
+	return true;
+}
+
+/* Keep track of memory to free along with the project, returning its index in owned, or -1 if out of memory */
+static intptr_t own(project_t *project, void *ptr) {
+	if(!ptr || !grow((void**)&project->owned, &project->ownedCapacity, project->numOwned, sizeof(void*))) {
+		free(ptr);
+		return -1;
+	}
+
+	project->owned[project->numOwned] = ptr;
+	return project->numOwned++;
+}
+
+static int lookup(const char **names, uint24_t count, const char *name) {
+	uint24_t i;
+
+	for(i = 0; i < count; i++) {
+		if(names[i] && !strcmp(names[i], name)) return i;
+	}
+
+	return -1;
+}
+
+/* Find a variable by name, adding it if it's new */
+static intptr_t findVariable(project_t *project, const char *name) {
+	variable_t *var;
+	uint24_t i;
+	intptr_t owned;
+
+	for(i = 0; i < project->numVars; i++) {
+		if(!strcmp(project->vars[i].name, name)) return i;
+	}
+
+	if(!grow((void**)&project->vars, &project->varCapacity, project->numVars, sizeof(variable_t))) return -1;
+
+	owned = own(project, strdup(name));
+	if(owned < 0) return -1;
+
+	var = &project->vars[project->numVars];
+	memset(var, 0, sizeof(variable_t));
+	var->name = project->owned[owned];
+	return project->numVars++;
+}
+
+static bool addElem(parser_t *parser, elemType_t type, void *data) {
+	projectScript_t *script = parser->script;
+
+	if(!grow((void**)&script->elems, &script->capacity, script->length, sizeof(scriptElem_t))) {
+		return fail(parser, "out of memory");
+	}
+
+	script->elems[script->length].type = type;
+	script->elems[script->length].data = data;
+	script->length++;
+
+	/* Count the inputs of whatever this is inside of */
+	if(parser->depth && type != TITLE_TEXT && type != BLOCK_END) parser->open[parser->depth - 1].inputs++;
+
+	return true;
+}
+
+/* Whether an elem has subelements, and so needs a BLOCK_END */
+static bool hasEnd(elemType_t type) {
+	switch(type) {
+		case ON_CONDITION_START:
+		case CUSTOM_BLOCK_START:
+		case BLOCK_START:
+		case REPORTER_START:
+		case PREDICATE_START:
+		case BLOCK_RING_START:
+		case C_BLOCK_START:
+		case REPORTER_RING_START:
+		case HIDDEN_REPORTER_RING_START:
+		case PREDICATE_RING_START:
+		case HIDDEN_PREDICATE_RING_START:
+		case ARGLIST_START:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool endElem(parser_t *parser) {
+	openElem_t *open;
+	scriptElem_t *start;
+	const primInfo_t *info;
+
+	if(!parser->script || !parser->depth) return fail(parser, "end without anything to end");
+
+	open = &parser->open[--parser->depth];
+	start = &parser->script->elems[open->start];
+
+	/* Primitives can leave inputs empty, but can't have extra ones */
+	if(start->type == BLOCK_START || start->type == REPORTER_START || start->type == PREDICATE_START) {
+		if(IS_PRIM(start->data)) {
+			info = &primitiveInfo[PRIM_ID(start->data)];
+			if(open->inputs > info->arity) {
+				return fail(parser, "%s takes %u inputs, but has %u",
+					primitiveNames[PRIM_ID(start->data)], info->arity, (unsigned)open->inputs);
+			}
+		}
+	}
+
+	/* Ends hold their start's index until the project is linked */
+	return addElem(parser, BLOCK_END, (void*)(uintptr_t)open->start);
+}
+
+/* Finish the current script, if there is one */
+static bool endScript(parser_t *parser) {
+	if(!parser->script) return true;
+
+	if(parser->depth) {
+		return fail(parser, "%s is never ended", elemNames[parser->script->elems[parser->open[parser->depth - 1].start].type]);
+	}
+
+	return addElem(parser, END_SCRIPT, NULL);
+}
+
+static bool startScript(parser_t *parser, char *arg) {
+	project_t *project = parser->project;
+	projectScript_t *script;
+	long x;
+	long y;
+	char *yArg;
+	char *end;
+
+	if(!endScript(parser)) return false;
+
+	x = strtol(arg, &yArg, 10);
+	y = strtol(yArg, &end, 10);
+	if(yArg == arg || end == yArg || *end) return fail(parser, "script needs an x and y");
+
+	if(!grow((void**)&project->scripts, &project->scriptCapacity, project->numScripts, sizeof(projectScript_t))) {
+		return fail(parser, "out of memory");
+	}
+
+	script = &project->scripts[project->numScripts++];
+	memset(script, 0, sizeof(projectScript_t));
+	script->x = x;
+	script->y = y;
+	parser->script = script;
+	return true;
+}
+
+/* Work out an elem's data from its argument */
+static bool parseData(parser_t *parser, elemType_t type, char *arg, void **data) {
+	project_t *project = parser->project;
+	float *number;
+	char *end;
+	char *name;
+	intptr_t index;
+	int found;
+
+	*data = NULL;
+
+	switch(type) {
+		case BLOCK_START:
+		case REPORTER_START:
+		case PREDICATE_START:
+			if(!*arg) return fail(parser, "%s needs a block", elemNames[type]);
+
+			found = lookup(primitiveNames, NUM_PRIMATIVES, arg);
+			if(found >= 0) {
+				*data = PRIM((uintptr_t)found);
+				return true;
+			}
+
+			/* Calls to custom blocks hold the index of their name until the project is linked */
+			index = own(project, strdup(arg));
+			if(index < 0) return fail(parser, "out of memory");
+			*data = (void*)index;
+			return true;
+
+		case CUSTOM_BLOCK_START:
+			if(parser->script->length) return fail(parser, "custom blocks have to be defined at the start of a script");
+
+			name = strchr(arg, ' ');
+			if(!name) return fail(parser, "CUSTOM_BLOCK_START needs a category and a name");
+			*name++ = 0;
+
+			found = lookup(categoryNames, sizeof(categoryNames) / sizeof(categoryNames[0]), arg);
+			if(found < 0) return fail(parser, "unknown category %s", arg);
+
+			index = own(project, strdup(name));
+			if(index < 0) return fail(parser, "out of memory");
+			parser->script->name = project->owned[index];
+
+			*data = (void*)(intptr_t)found;
+			return true;
+
+		case STRING_LITERAL:
+		case TITLE_TEXT:
+		case ON_MESSAGE:
+			index = own(project, strdup(arg));
+			if(index < 0) return fail(parser, "out of memory");
+			*data = project->owned[index];
+			return true;
+
+		case FLOAT_LITERAL:
+			number = malloc(sizeof(float));
+			if(!number) return fail(parser, "out of memory");
+			*number = strtod(arg, &end);
+			if(end == arg || *end) {
+				free(number);
+				return fail(parser, "%s isn't a number", arg);
+			}
+			if(own(project, number) < 0) return fail(parser, "out of memory");
+			*data = number;
+			return true;
+
+		case BOOLEAN_LITERAL:
+			if(!strcmp(arg, "false")) *data = (void*)0;
+			else if(!strcmp(arg, "true")) *data = (void*)1;
+			else if(!strcmp(arg, "empty")) *data = (void*)2;
+			else return fail(parser, "BOOLEAN_LITERAL has to be true, false or empty");
+			return true;
+
+		case VARIABLE:
+		case UPVAR:
+			if(!*arg) return fail(parser, "%s needs a name", elemNames[type]);
+			/* Variables hold their index until the project is linked */
+			index = findVariable(project, arg);
+			if(index < 0) return fail(parser, "out of memory");
+			*data = (void*)index;
+			return true;
+
+		case ON_KEY:
+			*data = (void*)(uintptr_t)strtoul(arg, &end, 0);
+			if(end == arg || *end || (uintptr_t)*data > 0xFF) return fail(parser, "ON_KEY needs a key code");
+			return true;
+
+		default:
+			if(*arg) return fail(parser, "%s doesn't take anything", elemNames[type]);
+			return true;
+	}
+}
+
+static bool parseLine(parser_t *parser, char *line) {
+	char *arg;
+	char *end;
+	void *data;
+	int type;
+
+	/* Trim the line */
+	while(*line == ' ' || *line == '\t') line++;
+	end = line + strlen(line);
+	while(end > line && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) *--end = 0;
+
+	if(!*line || *line == '#') return true;
+
+	/* Split off the argument */
+	for(arg = line; *arg && *arg != ' ' && *arg != '\t'; arg++);
+	if(*arg) {
+		*arg++ = 0;
+		while(*arg == ' ' || *arg == '\t') arg++;
+	}
+
+	if(!strcmp(line, "script")) return startScript(parser, arg);
+	if(!strcmp(line, "end") || !strcmp(line, "BLOCK_END")) return endElem(parser);
+
+	type = lookup(elemNames, NUM_ELEMENTS, line);
+	if(type < 0) return fail(parser, "unknown elem type %s", line);
+	if(type == END_SCRIPT) return fail(parser, "scripts are ended by the next script, or the end of the file");
+
+	if(!parser->script) return fail(parser, "%s before the first script", line);
+	if(!parseData(parser, type, arg, &data)) return false;
+	if(!addElem(parser, type, data)) return false;
+
+	if(hasEnd(type)) {
+		if(parser->depth == PARSE_MAX_DEPTH) return fail(parser, "nested too deeply");
+		parser->open[parser->depth].start = parser->script->length - 1;
+		parser->open[parser->depth].inputs = 0;
+		parser->depth++;
+	}
+
+	return true;
+}
+
+/* Find the script defining a custom block */
+static projectScript_t *findDefinition(project_t *project, const char *name) {
+	uint24_t i;
+
+	for(i = 0; i < project->numScripts; i++) {
+		if(project->scripts[i].name && !strcmp(project->scripts[i].name, name)) return &project->scripts[i];
+	}
+
+	return NULL;
+}
+
+/* Turn the indices elems were parsed with into pointers, like the calculator uses */
+static bool linkProject(parser_t *parser) {
+	project_t *project = parser->project;
+	projectScript_t *def;
+	uint24_t i;
+	uint24_t j;
+
+	for(i = 0; i < project->numScripts; i++) {
+		projectScript_t *script = &project->scripts[i];
+
+		for(j = 0; j < script->length; j++) {
+			scriptElem_t *elem = &script->elems[j];
+
+			switch(elem->type) {
+				case BLOCK_END:
+					elem->data = (void*)&script->elems[(uintptr_t)elem->data];
+					break;
+
+				case VARIABLE:
+				case UPVAR:
+					elem->data = (void*)&project->vars[(uintptr_t)elem->data];
+					break;
+
+				case BLOCK_START:
+				case REPORTER_START:
+				case PREDICATE_START:
+					if(IS_PRIM(elem->data)) break;
+					def = findDefinition(project, project->owned[(uintptr_t)elem->data]);
+					if(!def) return fail(parser, "no definition of custom block %s", (char*)project->owned[(uintptr_t)elem->data]);
+					elem->data = (void*)def->elems;
+					break;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool projectParse(project_t *project, const char *text) {
+	parser_t parser;
+	char *copy;
+	char *line;
+	char *next;
+	bool ok = true;
+	uint24_t i;
+
+	memset(project, 0, sizeof(project_t));
+	parser.project = project;
+	parser.script = NULL;
+	parser.depth = 0;
+	parser.line = 0;
+
+	/* Lines are split up in place */
+	copy = strdup(text);
+	if(!copy) return fail(&parser, "out of memory");
+
+	for(line = copy; ok && line; line = next) {
+		next = strchr(line, '\n');
+		if(next) *next++ = 0;
+		parser.line++;
+		ok = parseLine(&parser, line);
+	}
+
+	free(copy);
+
+	if(ok) ok = endScript(&parser);
+	parser.line = 0;
+	if(!ok) return false;
+
+	/* Names have to be unique, so that calls know which definition they mean */
+	for(i = 0; i < project->numScripts; i++) {
+		const char *name = project->scripts[i].name;
+		if(name && findDefinition(project, name) != &project->scripts[i]) {
+			return fail(&parser, "custom block %s is defined twice", name);
+		}
+	}
+
+	return linkProject(&parser);
+}
+
+uint24_t projectMeasure(project_t *project) {
+	uint24_t measured = 0;
+	uint24_t i;
+
+	for(i = 0; i < project->numScripts; i++) {
+		projectScript_t *script = &project->scripts[i];
+		uint24_t *widthCache = calloc(script->length, sizeof(uint24_t));
+		uint24_t *heightCache = calloc(script->length, sizeof(uint24_t));
+		scriptElem_t *elem = script->elems;
+
+		script->width = 0;
+		script->height = 0;
+
+		/* The same as measureScript in workspace.c */
+		while(elem->type != END_SCRIPT) {
+			uint24_t offset = elem - script->elems;
+			uint24_t width = getWidth(elem, NULL, widthCache ? widthCache + offset : NULL);
+
+			if(width > script->width) script->width = width;
+			script->height += getHeight(elem, NULL, heightCache ? heightCache + offset : NULL);
+			elem = getNextSibling(elem);
+		}
+
+		/* The notch under the last block sticks out of it */
+		script->height += NOTCH_DEPTH;
+		measured += script->length;
+
+		free(widthCache);
+		free(heightCache);
+	}
+
+	return measured;
+}
+
+/* A growing buffer for the binary form */
+typedef struct Output {
+	uint8_t *data;
+	uint24_t size;
+	uint24_t capacity;
+	bool failed;
+} output_t;
+
+static void putBytes(output_t *out, const void *bytes, size_t count) {
+	while(!out->failed && out->size + count > out->capacity) {
+		out->failed = !grow((void**)&out->data, &out->capacity, out->capacity, 1);
+	}
+	if(out->failed) return;
+
+	memcpy(out->data + out->size, bytes, count);
+	out->size += count;
+}
+
+static void putByte(output_t *out, uint8_t byte) {
+	putBytes(out, &byte, 1);
+}
+
+/* 24 bits, little endian, like the eZ80 */
+static void put24(output_t *out, uint24_t value) {
+	uint8_t bytes[3];
+
+	bytes[0] = value;
+	bytes[1] = value >> 8;
+	bytes[2] = value >> 16;
+	putBytes(out, bytes, 3);
+}
+
+static void putText(output_t *out, const char *text) {
+	putBytes(out, text, strlen(text) + 1);
+}
+
+static uint24_t scriptIndex(project_t *project, scriptElem_t *elems) {
+	uint24_t i;
+
+	for(i = 0; i < project->numScripts && project->scripts[i].elems != elems; i++);
+	return i;
+}
+
+static void putElem(output_t *out, project_t *project, projectScript_t *script, scriptElem_t *elem) {
+	putByte(out, elem->type);
+
+	switch(elem->type) {
+		case BLOCK_END:
+			put24(out, (scriptElem_t*)elem->data - script->elems);
+			break;
+
+		case BLOCK_START:
+		case REPORTER_START:
+		case PREDICATE_START:
+			put24(out, IS_PRIM(elem->data) ? (uint24_t)elem->data : scriptIndex(project, (scriptElem_t*)elem->data));
+			break;
+
+		case CUSTOM_BLOCK_START:
+			put24(out, (uint24_t)elem->data);
+			break;
+
+		case STRING_LITERAL:
+		case TITLE_TEXT:
+		case ON_MESSAGE:
+			putText(out, elem->data);
+			break;
+
+		case FLOAT_LITERAL:
+			putBytes(out, elem->data, sizeof(float));
+			break;
+
+		case VARIABLE:
+		case UPVAR:
+			put24(out, (variable_t*)elem->data - project->vars);
+			break;
+
+		case BOOLEAN_LITERAL:
+		case ON_KEY:
+			putByte(out, (uint24_t)elem->data);
+			break;
+	}
+}
+
+uint8_t *projectEncode(project_t *project, size_t *size) {
+	output_t out = {NULL, 0, 0, false};
+	uint24_t i;
+	uint24_t j;
+
+	putBytes(&out, PROJECT_MAGIC, 3);
+	putByte(&out, PROJECT_VERSION);
+
+	put24(&out, project->numVars);
+	for(i = 0; i < project->numVars; i++) {
+		putText(&out, project->vars[i].name);
+	}
+
+	put24(&out, project->numScripts);
+	for(i = 0; i < project->numScripts; i++) {
+		projectScript_t *script = &project->scripts[i];
+
+		put24(&out, script->x);
+		put24(&out, script->y);
+		put24(&out, script->width);
+		put24(&out, script->height);
+		put24(&out, script->length);
+
+		for(j = 0; j < script->length; j++) {
+			putElem(&out, project, script, &script->elems[j]);
+		}
+	}
+
+	if(out.failed) {
+		free(out.data);
+		return NULL;
+	}
+
+	*size = out.size;
+	return out.data;
+}
+
+void projectFree(project_t *project) {
+	uint24_t i;
+
+	for(i = 0; i < project->numScripts; i++) {
+		free(project->scripts[i].elems);
+	}
+	for(i = 0; i < project->numOwned; i++) {
+		free(project->owned[i]);
+	}
+
+	free(project->scripts);
+	free(project->vars);
+	free(project->owned);
+
+	project->scripts = NULL;
+	project->vars = NULL;
+	project->owned = NULL;
+	project->numScripts = 0;
+	project->numVars = 0;
+	project->numOwned = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef H_PROJECT
+#define H_PROJECT
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tice.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "script.h"
+#include "value.h"
+
+/* Projects are written as text, one elem per line: */
+/*   script x y                 starts a new script at x, y in the workspace */
+/*   TYPE argument              an elem, where TYPE is its ElemTypes name, e.g. BLOCK_START REPEAT */
+/*   end                        the BLOCK_END of the innermost elem that hasn't been ended yet */
+/* Indentation is ignored, and lines starting with # are comments */
+/* Arguments depend on the type: */
+/*   BLOCK_START, REPORTER_START, PREDICATE_START    a primitive ID from primtable.h, or a custom block's name */
+/*   CUSTOM_BLOCK_START                              a category from Categories, then the block's name */
+/*   STRING_LITERAL, TITLE_TEXT, ON_MESSAGE          the rest of the line */
+/*   FLOAT_LITERAL                                   a number */
+/*   BOOLEAN_LITERAL                                 true, false or empty */
+/*   VARIABLE, UPVAR                                 a variable name, shared by the whole project */
+/*   ON_KEY                                          a key code */
+/* Custom blocks are defined by a script starting with CUSTOM_BLOCK_START */
+
+/* Converted projects are written as: */
+/*   "SNB" and a version byte */
+/*   number of variables, then each one's name */
+/*   number of scripts, then for each one x, y, width, height, number of elems, and the elems */
+/* Numbers are 24 bits, little endian, and text is null terminated */
+/* Each elem is its type byte followed by its data: */
+/*   BLOCK_END                       index of the start within the script */
+/*   block starts                    0x800000 + primitive ID, or the index of the custom block's script */
+/*   CUSTOM_BLOCK_START              category */
+/*   text                            the text */
+/*   FLOAT_LITERAL                   an IEEE single, like the calculator's float */
+/*   VARIABLE, UPVAR                 index of the variable */
+/*   BOOLEAN_LITERAL, ON_KEY         one byte */
+#define PROJECT_MAGIC "SNB"
+/* Bumped whenever the layout changes, or when rows in primtable.h are reordered or removed */
+#define PROJECT_VERSION 1
+
+/* Longest error message, including the null terminator */
+#define PROJECT_ERROR_SIZE 160
+
+typedef struct ProjectScript {
+	scriptElem_t *elems;
+	uint24_t length;		/* Including END_SCRIPT */
+	uint24_t capacity;
+	int24_t x;
+	int24_t y;
+	uint24_t width;			/* Bounding box, filled in by projectMeasure */
+	uint24_t height;
+	const char *name;		/* Name custom block definitions are called by, or NULL */
+} projectScript_t;
+
+typedef struct Project {
+	projectScript_t *scripts;
+	uint24_t numScripts;
+	uint24_t scriptCapacity;
+	variable_t *vars;
+	uint24_t numVars;
+	uint24_t varCapacity;
+	void **owned;			/* Text and floats that elems point to, freed with the project */
+	uint24_t numOwned;
+	uint24_t ownedCapacity;
+	char error[PROJECT_ERROR_SIZE];	/* Why projectParse failed */
+} project_t;
+
+/* Read a project from its text form, checking that every start has an end and every block exists */
+/* The project has to be freed even if this fails */
+/* Returns false if the project isn't valid, with the reason in error */
+bool projectParse(project_t *project, const char *text);
+
+/* Work out the bounding box of every script, the same way the calculator lays them out */
+/* Returns the number of elems measured */
+uint24_t projectMeasure(project_t *project);
+
+/* Convert a parsed project to its binary form */
+/* Returns a buffer to be freed by the caller, or NULL if out of memory */
+uint8_t *projectEncode(project_t *project, size_t *size);
+
+void projectFree(project_t *project);
+
+#endif
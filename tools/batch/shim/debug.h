@@ -0,0 +1,7 @@
+#ifndef H_SHIM_DEBUG
+#define H_SHIM_DEBUG
+
+/* There is no debug console, so debug output is thrown away */
+#define dbg_sprintf(...) ((void)0)
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef H_SHIM_GFX_GROUP
+#define H_SHIM_GFX_GROUP
+
+/* Stands in for the header convpng generates from src/gfx, see hostgfx.c */
+
+#include <graphx.h>
+
+extern gfx_sprite_t *colors;
+extern gfx_sprite_t *hat;
+extern gfx_sprite_t *flag;
+
+#endif
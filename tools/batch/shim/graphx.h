@@ -0,0 +1,35 @@
+#ifndef H_SHIM_GRAPHX
+#define H_SHIM_GRAPHX
+
+/* Just enough of graphx to build the calculator sources on a PC */
+/* Nothing is drawn, but text and sprites are measured the same way */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tice.h>
+
+typedef struct {
+	uint8_t width;
+	uint8_t height;
+	uint8_t data[1];
+} gfx_sprite_t;
+
+enum {
+	gfx_black = 0x00,
+	gfx_white = 0xFF
+};
+
+uint8_t gfx_SetColor(uint8_t index);
+void gfx_SetTextScale(uint8_t widthScale, uint8_t heightScale);
+unsigned int gfx_GetCharWidth(const char c);
+unsigned int gfx_GetStringWidth(const char *string);
+
+void gfx_HorizLine(int x, int y, int length);
+void gfx_Rectangle(int x, int y, int width, int height);
+void gfx_FillRectangle(int x, int y, int width, int height);
+void gfx_FillCircle(int x, int y, unsigned int radius);
+void gfx_TransparentSprite(gfx_sprite_t *sprite, int x, int y);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef H_SHIM_TICE
+#define H_SHIM_TICE
+
+/* Just enough of the CE C library's tice.h to build the calculator sources on a PC */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The calculator code keeps pointers in these, so they have to be as wide as a pointer here */
+typedef intptr_t int24_t;
+typedef uintptr_t uint24_t;
+
+#define LCD_WIDTH	320
+#define LCD_HEIGHT	240
+
+#endif